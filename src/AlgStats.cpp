@@ -3,15 +3,38 @@
 StatsEntry::StatsEntry(size_t n, size_t b, size_t m, size_t w) 
     : mNumOfElements(n), mBestCaseTime(b), mMidCaseTime(m), mWorstCaseTime(w) {}
 
-AlgStats::~AlgStats() {
-    for (auto const& val: mHistory)
-        delete val;
+void AlgStats::Reserve(size_t points) {
+    mColumns.mNumOfElements.reserve(points);
+    mColumns.mBestCaseTime.reserve(points);
+    mColumns.mMidCaseTime.reserve(points);
+    mColumns.mWorstCaseTime.reserve(points);
+    mColumns.mBytesPerElement.reserve(points);
+    mColumns.mCore.reserve(points);
+    mColumns.mFreqMHz.reserve(points);
+    mColumns.mTurbo.reserve(points);
+    mColumns.mAllocCount.reserve(points);
+    mColumns.mAllocBytes.reserve(points);
+    mColumns.mPeakRssKb.reserve(points);
 }
 
-void AlgStats::Add(StatsEntry* e) {
-    mHistory.push_back(e);
+void AlgStats::Add(const StatsEntry& e) {
+    mColumns.mNumOfElements.push_back(e.mNumOfElements);
+    mColumns.mBestCaseTime.push_back(e.mBestCaseTime);
+    mColumns.mMidCaseTime.push_back(e.mMidCaseTime);
+    mColumns.mWorstCaseTime.push_back(e.mWorstCaseTime);
+    mColumns.mBytesPerElement.push_back(e.mBytesPerElement);
+    mColumns.mCore.push_back(e.mCore);
+    mColumns.mFreqMHz.push_back(e.mFreqMHz);
+    mColumns.mTurbo.push_back(e.mTurbo);
+    mColumns.mAllocCount.push_back(e.mAllocCount);
+    mColumns.mAllocBytes.push_back(e.mAllocBytes);
+    mColumns.mPeakRssKb.push_back(e.mPeakRssKb);
 }
 
-const std::vector<StatsEntry*>& AlgStats::GetHistory() const {
-    return mHistory;
+size_t AlgStats::Size() const {
+    return mColumns.mNumOfElements.size();
+}
+
+const StatsColumns& AlgStats::GetColumns() const {
+    return mColumns;
 }
\ No newline at end of file
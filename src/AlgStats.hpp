@@ -17,8 +17,32 @@ public:
     size_t mBestCaseTime;
     size_t mMidCaseTime;
     size_t mWorstCaseTime;
+    double mBytesPerElement = 0;
+    int mCore = -1;             ///< core of the isolated run, -1 if not isolated
+    long mFreqMHz = -1;         ///< core frequency after the run, -1 if unknown
+    int mTurbo = -1;            ///< 1 - turbo enabled, 0 - disabled, -1 - unknown
+    size_t mAllocCount = 0;     ///< allocations made by one middle case sort
+    size_t mAllocBytes = 0;     ///< bytes allocated by one middle case sort
+    long mPeakRssKb = -1;       ///< peak RSS growth of one middle case sort, -1 if unknown
 };
 
+/**
+ * @brief Testing history of an algorithm, one vector per StatsEntry field.
+ * 
+ */
+struct StatsColumns {
+    std::vector<size_t> mNumOfElements;
+    std::vector<size_t> mBestCaseTime;
+    std::vector<size_t> mMidCaseTime;
+    std::vector<size_t> mWorstCaseTime;
+    std::vector<double> mBytesPerElement;
+    std::vector<int> mCore;
+    std::vector<long> mFreqMHz;
+    std::vector<int> mTurbo;
+    std::vector<size_t> mAllocCount;
+    std::vector<size_t> mAllocBytes;
+    std::vector<long> mPeakRssKb;
+};
 
 /**
  * @brief Class containing the results of tested sorting algorithm.
@@ -33,25 +57,34 @@ public:
     AlgStats() {};
 
     /**
-     * @brief Destroy the Alg Stats object
+     * @brief Reserves the columns for the given number of test iterations,
+     * so adding the entries of a planned sweep does not allocate.
      * 
+     * @param points - number of test iterations
      */
-    ~AlgStats();
+    void Reserve(size_t points);
     
     /**
-     * @brief Method adds the entry e to the mHistory vector.
+     * @brief Method appends the entry e to the history columns.
      * 
      */ 
-    void Add(StatsEntry* e);
+    void Add(const StatsEntry& e);
+
+    /**
+     * @brief Returns the number of stored test iterations.
+     * 
+     * @return size_t - number of test iterations
+     */
+    size_t Size() const;
 
     /**
-     * @biref Method returns a reference on the mHistory vector.
+     * @brief Method returns a reference on the history columns.
      * 
      */
-    const std::vector<StatsEntry*>& GetHistory() const;
+    const StatsColumns& GetColumns() const;
 
 private:
-    std::vector<StatsEntry*> mHistory = {};
+    StatsColumns mColumns;
 };
 
 #endif
\ No newline at end of file
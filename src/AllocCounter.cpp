@@ -0,0 +1,152 @@
+#include "AllocCounter.hpp"
+
+#include <atomic>
+#include <cstdlib>
+#include <fstream>
+#include <new>
+#include <string>
+
+static std::atomic<size_t> sCount(0);
+static std::atomic<size_t> sBytes(0);
+static thread_local bool sIgnored = false;
+
+/**
+ * @brief Reads a "<key>: <value> kB" line of /proc/self/status.
+ * 
+ * @param key - name of the line
+ * @return long - value in KB, -1 if not found
+ */
+static long ReadStatus(const std::string& key) {
+    std::ifstream in("/proc/self/status");
+    for (std::string line; std::getline(in, line);)
+        if (line.compare(0, key.size(), key) == 0 && line[key.size()] == ':')
+            return std::stol(line.substr(key.size() + 1));
+    return -1;
+}
+
+void AllocCounter::Record(size_t bytes) {
+    if (sIgnored)
+        return;
+    sCount.fetch_add(1, std::memory_order_relaxed);
+    sBytes.fetch_add(bytes, std::memory_order_relaxed);
+}
+
+void AllocCounter::Ignore(bool ignored) {
+    sIgnored = ignored;
+}
+
+AllocUsage AllocCounter::Read() {
+    AllocUsage u;
+    u.mCount = sCount.load(std::memory_order_relaxed);
+    u.mBytes = sBytes.load(std::memory_order_relaxed);
+    return u;
+}
+
+bool AllocCounter::ResetPeakRss() {
+    std::ofstream out("/proc/self/clear_refs");
+    out << "5";
+    out.flush();
+    return out.good();
+}
+
+long AllocCounter::RssKb() {
+    return ReadStatus("VmRSS");
+}
+
+long AllocCounter::PeakRssKb() {
+    return ReadStatus("VmHWM");
+}
+
+/**
+ * @brief Counts the allocation and allocates it with malloc,
+ * calling the new handler while the allocation fails.
+ * 
+ * @param n - allocated bytes
+ * @param align - alignment, 0 for the default one
+ * @return void* - allocated memory
+ */
+static void* CountedNew(size_t n, size_t align) {
+    AllocCounter::Record(n);
+    n = n ? n : 1;
+    while (true) {
+        void* p = align ? aligned_alloc(align, (n + align - 1) / align * align) : malloc(n);
+        if (p)
+            return p;
+        std::new_handler handler = std::get_new_handler();
+        if (!handler)
+            throw std::bad_alloc();
+        handler();
+    }
+}
+
+void* operator new(size_t n) {
+    return CountedNew(n, 0);
+}
+
+void* operator new[](size_t n) {
+    return CountedNew(n, 0);
+}
+
+void* operator new(size_t n, std::align_val_t a) {
+    return CountedNew(n, static_cast<size_t>(a));
+}
+
+void* operator new[](size_t n, std::align_val_t a) {
+    return CountedNew(n, static_cast<size_t>(a));
+}
+
+void* operator new(size_t n, const std::nothrow_t&) noexcept {
+    try {
+        return CountedNew(n, 0);
+    } catch (...) {
+        return nullptr;
+    }
+}
+
+void* operator new[](size_t n, const std::nothrow_t&) noexcept {
+    try {
+        return CountedNew(n, 0);
+    } catch (...) {
+        return nullptr;
+    }
+}
+
+void operator delete(void* p) noexcept {
+    free(p);
+}
+
+void operator delete[](void* p) noexcept {
+    free(p);
+}
+
+void operator delete(void* p, size_t) noexcept {
+    free(p);
+}
+
+void operator delete[](void* p, size_t) noexcept {
+    free(p);
+}
+
+void operator delete(void* p, std::align_val_t) noexcept {
+    free(p);
+}
+
+void operator delete[](void* p, std::align_val_t) noexcept {
+    free(p);
+}
+
+void operator delete(void* p, size_t, std::align_val_t) noexcept {
+    free(p);
+}
+
+void operator delete[](void* p, size_t, std::align_val_t) noexcept {
+    free(p);
+}
+
+void operator delete(void* p, const std::nothrow_t&) noexcept {
+    free(p);
+}
+
+void operator delete[](void* p, const std::nothrow_t&) noexcept {
+    free(p);
+}
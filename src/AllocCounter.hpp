@@ -0,0 +1,69 @@
+#ifndef __jch_AllocCounter_hpp__
+#define __jch_AllocCounter_hpp__
+
+#include <cstddef>
+
+/**
+ * @brief Memory used by one sort.
+ * 
+ */
+struct AllocUsage {
+    size_t mCount = 0;          ///< number of allocations
+    size_t mBytes = 0;          ///< allocated bytes
+    long mPeakRssKb = -1;       ///< peak RSS growth, -1 if unknown
+};
+
+/**
+ * @brief Process wide allocation counter. The global operator new
+ * overloads and the mapped buffers of Memory::Allocate report every
+ * allocation to it.
+ * 
+ */
+namespace AllocCounter {
+    /**
+     * @brief Counts one allocation.
+     * 
+     * @param bytes - allocated bytes
+     */
+    void Record(size_t bytes);
+
+    /**
+     * @brief Stops or resumes counting the allocations of the calling
+     * thread, used by the background threads running beside the sorts.
+     * 
+     * @param ignored - true to stop counting
+     */
+    void Ignore(bool ignored);
+
+    /**
+     * @brief Returns the allocations counted since the start.
+     * 
+     * @return AllocUsage - allocation count and bytes, no RSS
+     */
+    AllocUsage Read();
+
+    /**
+     * @brief Resets the peak RSS of the process to the current RSS
+     * through /proc/self/clear_refs.
+     * 
+     * @return true - the peak was reset
+     * @return false - the kernel does not allow it
+     */
+    bool ResetPeakRss();
+
+    /**
+     * @brief Returns the current RSS of the process.
+     * 
+     * @return long - RSS in KB, -1 if unknown
+     */
+    long RssKb();
+
+    /**
+     * @brief Returns the peak RSS of the process since the last reset.
+     * 
+     * @return long - peak RSS in KB, -1 if unknown
+     */
+    long PeakRssKb();
+}
+
+#endif
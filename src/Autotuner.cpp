@@ -0,0 +1,84 @@
+#include "Autotuner.hpp"
+
+#include <cmath>
+#include <thread>
+
+Autotuner::Autotuner(uint max_threads) :
+    mMaxThreads(max_threads ? max_threads : std::max(1u, std::thread::hardware_concurrency())) {
+    mTester.SetCalibration(false);
+}
+
+TuningProfile Autotuner::Tune(const std::vector<size_t>& lengths) {
+    TuningProfile profile;
+    for (size_t c = 0; c < lengths.size(); c++) {
+        std::cout << "Tuning length: " << lengths[c] << std::endl;
+        TuningParams best = SuccessiveHalving(lengths[c], Candidates(lengths[c]));
+        best.mMaxLength = c + 1 < lengths.size()
+                        ? (size_t)std::sqrt((double)lengths[c] * lengths[c + 1])
+                        : SIZE_MAX;
+        std::cout << best.ToString() << std::endl;
+        profile.mClasses.push_back(best);
+    }
+    std::cout << "TUNING DONE!" << std::endl;
+    return profile;
+}
+
+std::vector<TuningParams> Autotuner::Candidates(size_t len) const {
+    std::vector<uint> threads;
+    for (uint th = 1; th < mMaxThreads; th *= 2)
+        threads.push_back(th);
+    threads.push_back(mMaxThreads);
+
+    std::vector<TuningParams> cands;
+    for (uint th: threads) {
+        // one grain spreading the work over the threads and a coarser one
+        std::vector<size_t> grains = {std::max<size_t>(len / (4 * th), 1024)};
+        if (th > 1)
+            grains.push_back(std::max<size_t>(len / th, 1024));
+        for (size_t grain: grains) {
+            for (uint bits: {8, 11, 16}) {
+                TuningParams p;
+                p.mRadixBits = bits;
+                p.mThreads = th;
+                p.mSpawnGrain = grain;
+                cands.push_back(p);
+            }
+            for (PartitionScheme ps: {PartitionScheme::Lomuto, PartitionScheme::ThreeWay,
+                                      PartitionScheme::DualPivot}) {
+                for (uint cutoff: {8, 16, 32, 64}) {
+                    TuningParams p;
+                    p.mScheme = ps;
+                    p.mInsertionCutoff = cutoff;
+                    p.mThreads = th;
+                    p.mSpawnGrain = grain;
+                    cands.push_back(p);
+                }
+            }
+        }
+    }
+    return cands;
+}
+
+TuningParams Autotuner::SuccessiveHalving(size_t len, std::vector<TuningParams> candidates) {
+    // the first round sorts about 2^20 elements per candidate
+    size_t rep = std::max<size_t>(1, (1 << 20) / len);
+    // every candidate of every round sorts the same keys
+    mTester.PrepareInput(len);
+    while (candidates.size() > 1) {
+        std::vector<std::pair<size_t, size_t>> times;
+        for (size_t i = 0; i < candidates.size(); i++) {
+            TuningProfile single;
+            single.mClasses.push_back(candidates[i]);
+            AutoSort alg = AutoSort(single);
+            times.push_back({mTester.Measure(alg, rep), i});
+        }
+        std::sort(times.begin(), times.end());
+
+        std::vector<TuningParams> survivors;
+        for (size_t i = 0; i < (times.size() + 1) / 2; i++)
+            survivors.push_back(candidates[times[i].second]);
+        candidates.swap(survivors);
+        rep *= 2;
+    }
+    return candidates[0];
+}
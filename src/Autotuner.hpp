@@ -0,0 +1,57 @@
+#ifndef __jch_Autotuner_hpp__
+#define __jch_Autotuner_hpp__
+
+#include <vector>
+
+#include "Sorting.hpp"
+#include "TesterFramework.hpp"
+
+/**
+ * @brief Searches the AutoSort parameters of every size class on the
+ * current machine by successive halving: all candidates are measured
+ * with a small budget, the faster half survives and the budget doubles
+ * until a single candidate is left.
+ * 
+ */
+class Autotuner {
+public:
+    /**
+     * @brief Construct a new Autotuner object
+     * 
+     * @param max_threads - largest tried thread count, 0 for hardware_concurrency()
+     */
+    Autotuner(uint max_threads = 0);
+
+    /**
+     * @brief Tunes one size class per length, the class boundaries lie
+     * at the geometric means of the neighbouring lengths.
+     * 
+     * @param lengths - representative lengths of the size classes, ascending
+     * @return TuningProfile - tuned profile
+     */
+    TuningProfile Tune(const std::vector<size_t>& lengths = {1 << 10, 1 << 14, 1 << 18, 1 << 22});
+
+private:
+    /**
+     * @brief Returns the searched parameter space for the length.
+     * 
+     * @param len - vector length
+     * @return std::vector<TuningParams> - candidate parameters
+     */
+    std::vector<TuningParams> Candidates(size_t len) const;
+
+    /**
+     * @brief Selects the fastest candidate by successive halving.
+     * 
+     * @param len - vector length
+     * @param candidates - candidate parameters
+     * @return TuningParams - fastest candidate
+     */
+    TuningParams SuccessiveHalving(size_t len, std::vector<TuningParams> candidates);
+
+private:
+    TesterFramework mTester;
+    uint mMaxThreads;
+};
+
+#endif
@@ -0,0 +1,176 @@
+#include "Dataset.hpp"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <algorithm>
+#include <climits>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <sstream>
+
+/**
+ * @brief Parses a decimal size field of a dataset description.
+ * 
+ * @param field - text of the field
+ * @param value - parsed value
+ * @return true - the field is a number
+ * @return false - the field is empty or not a number
+ */
+static bool ParseSize(const std::string& field, size_t& value) {
+    if (field.empty() || field.size() > 18 ||
+        field.find_first_not_of("0123456789") != std::string::npos)
+        return false;
+    value = std::stoull(field);
+    return true;
+}
+
+bool DatasetSpec::Parse(const std::string& arg, DatasetSpec& spec) {
+    std::vector<std::string> parts;
+    std::istringstream in(arg);
+    for (std::string part; std::getline(in, part, ':');)
+        parts.push_back(part);
+
+    spec = DatasetSpec();
+    spec.mPath = parts.empty() ? arg : parts[0];
+    std::string format = parts.size() > 1 ? parts[1] : "int32";
+    bool valid = !spec.mPath.empty();
+    if (format == "int32" || format == "int64") {
+        spec.mFormat = format == "int64" ? DatasetFormat::Int64 : DatasetFormat::Int32;
+        valid = valid && parts.size() <= 2;
+    } else if (format == "record") {
+        spec.mFormat = DatasetFormat::Record;
+        valid = valid && parts.size() == 5 && ParseSize(parts[2], spec.mRecordSize) &&
+                ParseSize(parts[3], spec.mKeyOffset) && ParseSize(parts[4], spec.mKeySize) &&
+                (spec.mKeySize == 4 || spec.mKeySize == 8) &&
+                spec.mKeyOffset + spec.mKeySize <= spec.mRecordSize;
+    } else {
+        valid = false;
+    }
+    if (!valid)
+        std::cerr << "Invalid dataset " << arg << ", expected <file>[:int32|:int64|"
+                  << ":record:<size>:<key offset>:<4|8>]" << std::endl;
+    return valid;
+}
+
+std::string DatasetSpec::Key() const {
+    return mPath + ':' + std::to_string((int)mFormat) + ':' + std::to_string(mRecordSize)
+           + ':' + std::to_string(mKeyOffset) + ':' + std::to_string(mKeySize);
+}
+
+MappedFile::MappedFile(const std::string& path) {
+    int fd = open(path.c_str(), O_RDONLY);
+    struct stat st;
+    if (fd < 0 || fstat(fd, &st) != 0 || st.st_size == 0) {
+        if (fd >= 0)
+            close(fd);
+        return;
+    }
+    void* p = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (p == MAP_FAILED)
+        return;
+    madvise(p, st.st_size, MADV_WILLNEED);
+    mData = static_cast<const char*>(p);
+    mSize = st.st_size;
+}
+
+MappedFile::~MappedFile() {
+    if (mData)
+        munmap(const_cast<char*>(mData), mSize);
+}
+
+const char* MappedFile::Data() const {
+    return mData;
+}
+
+size_t MappedFile::Size() const {
+    return mSize;
+}
+
+Dataset::Dataset(const DatasetSpec& spec) :
+    mName(spec.mPath), mFile(new MappedFile(spec.mPath)) {
+    if (!mFile->Data()) {
+        std::cerr << "Cannot map dataset " << spec.mPath << std::endl;
+        return;
+    }
+    const char* raw = mFile->Data();
+
+    if (spec.mFormat == DatasetFormat::Int32) {
+        // the mapping is page aligned, the keys are used in place
+        mData = reinterpret_cast<const int*>(raw);
+        mSize = mFile->Size() / sizeof(int32_t);
+        return;
+    }
+
+    size_t stride = spec.mFormat == DatasetFormat::Int64 ? 8 : spec.mRecordSize;
+    size_t offset = spec.mFormat == DatasetFormat::Int64 ? 0 : spec.mKeyOffset;
+    size_t width = spec.mFormat == DatasetFormat::Int64 ? 8 : spec.mKeySize;
+    if (stride == 0 || offset + width > stride || (width != 4 && width != 8)) {
+        std::cerr << "Invalid record layout of " << spec.mPath << std::endl;
+        return;
+    }
+
+    size_t n = mFile->Size() / stride;
+    std::vector<int64_t> keys(n);
+    for (size_t i = 0; i < n; i++) {
+        if (width == 4) {
+            int32_t k;
+            memcpy(&k, raw + i * stride + offset, sizeof(k));
+            keys[i] = k;
+        } else {
+            memcpy(&keys[i], raw + i * stride + offset, sizeof(keys[i]));
+        }
+    }
+
+    mKeys.resize(n);
+    auto range = std::minmax_element(keys.begin(), keys.end());
+    if (n == 0 || (*range.first >= INT_MIN && *range.second <= INT_MAX)) {
+        std::copy(keys.begin(), keys.end(), mKeys.begin());
+    } else {
+        std::vector<int64_t> uniq(keys);
+        std::sort(uniq.begin(), uniq.end());
+        uniq.erase(std::unique(uniq.begin(), uniq.end()), uniq.end());
+        for (size_t i = 0; i < n; i++)
+            mKeys[i] = std::lower_bound(uniq.begin(), uniq.end(), keys[i]) - uniq.begin();
+    }
+    // the converted keys do not need the mapping anymore
+    mFile.reset();
+    mData = mKeys.data();
+    mSize = n;
+}
+
+const int* Dataset::Data() const {
+    return mData;
+}
+
+size_t Dataset::Size() const {
+    return mSize;
+}
+
+const std::string& Dataset::GetName() const {
+    return mName;
+}
+
+std::mutex DatasetCache::sMutex;
+std::map<std::string, std::shared_ptr<Dataset>> DatasetCache::sDatasets;
+
+std::shared_ptr<Dataset> DatasetCache::Get(const DatasetSpec& spec) {
+    std::lock_guard<std::mutex> lock(sMutex);
+    std::shared_ptr<Dataset>& ds = sDatasets[spec.Key()];
+    if (!ds)
+        ds = std::make_shared<Dataset>(spec);
+    return ds;
+}
+
+void DatasetCache::Clear() {
+    std::lock_guard<std::mutex> lock(sMutex);
+    for (auto it = sDatasets.begin(); it != sDatasets.end();) {
+        if (it->second.use_count() == 1)
+            it = sDatasets.erase(it);
+        else
+            ++it;
+    }
+}
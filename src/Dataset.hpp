@@ -0,0 +1,151 @@
+#ifndef __jch_Dataset_hpp__
+#define __jch_Dataset_hpp__
+
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+/**
+ * @brief Layout of a binary little-endian dataset file.
+ * Int32: packed int32 keys, used in place without any copy.
+ * Int64: packed int64 keys.
+ * Record: fixed size records with an int32 or int64 key at a fixed offset.
+ */
+enum class DatasetFormat { Int32, Int64, Record };
+
+/**
+ * @brief Description of a dataset file.
+ * 
+ */
+struct DatasetSpec {
+    std::string mPath;
+    DatasetFormat mFormat = DatasetFormat::Int32;
+    size_t mRecordSize = 0;     ///< record size in bytes (Record format)
+    size_t mKeyOffset = 0;      ///< key offset inside the record (Record format)
+    size_t mKeySize = 4;        ///< key width in bytes, 4 or 8 (Record format)
+
+    /**
+     * @brief Parses "path[:int32|int64|record:<size>:<offset>:<key size>]".
+     * Unknown formats, incomplete record layouts and non-numeric fields
+     * are reported and rejected.
+     * 
+     * @param arg - command line description of the dataset
+     * @param spec - parsed description
+     * @return true - the description is valid
+     * @return false - the description is malformed
+     */
+    static bool Parse(const std::string& arg, DatasetSpec& spec);
+
+    /**
+     * @brief Returns a key identifying the file and its layout.
+     * 
+     * @return std::string - cache key
+     */
+    std::string Key() const;
+};
+
+/**
+ * @brief Read-only memory mapping of a whole file.
+ * 
+ */
+class MappedFile {
+public:
+    /**
+     * @brief Maps the file, Data() is nullptr if it cannot be mapped.
+     * 
+     * @param path - path of the file
+     */
+    MappedFile(const std::string& path);
+
+    /**
+     * @brief Unmaps the file
+     * 
+     */
+    ~MappedFile();
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    const char* Data() const;
+    size_t Size() const;
+
+private:
+    const char* mData = nullptr;
+    size_t mSize = 0;
+};
+
+/**
+ * @brief Keys of a dataset file as int32 values.
+ * Int32 files are served straight from the mapping. Wider keys are
+ * converted once; if they do not fit into int32 they are replaced
+ * by their dense rank, which keeps the order and the duplicates, so
+ * the sorts do the same comparisons as on the original keys.
+ * 
+ */
+class Dataset {
+public:
+    /**
+     * @brief Construct a new Dataset object
+     * 
+     * @param spec - description of the dataset file
+     */
+    Dataset(const DatasetSpec& spec);
+
+    /**
+     * @brief Get the first key
+     * 
+     * @return const int* - keys, nullptr if the file could not be loaded
+     */
+    const int* Data() const;
+
+    /**
+     * @brief Get the number of keys
+     * 
+     * @return size_t - number of keys
+     */
+    size_t Size() const;
+
+    /**
+     * @brief Get the name of the dataset file
+     * 
+     * @return const std::string& - path of the file
+     */
+    const std::string& GetName() const;
+
+private:
+    std::string mName;
+    std::unique_ptr<MappedFile> mFile;
+    std::vector<int> mKeys;
+    const int* mData = nullptr;
+    size_t mSize = 0;
+};
+
+/**
+ * @brief Process wide cache of loaded datasets, every file is mapped
+ * and converted once no matter how many sweeps and algorithms use it.
+ * 
+ */
+class DatasetCache {
+public:
+    /**
+     * @brief Returns the dataset, loading it on the first request.
+     * 
+     * @param spec - description of the dataset file
+     * @return std::shared_ptr<Dataset> - loaded dataset
+     */
+    static std::shared_ptr<Dataset> Get(const DatasetSpec& spec);
+
+    /**
+     * @brief Drops all cached datasets which are not used anymore.
+     * 
+     */
+    static void Clear();
+
+private:
+    static std::mutex sMutex;
+    static std::map<std::string, std::shared_ptr<Dataset>> sDatasets;
+};
+
+#endif
@@ -0,0 +1,230 @@
+#include "Memory.hpp"
+#include "AllocCounter.hpp"
+
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <mutex>
+#include <new>
+#include <sstream>
+
+#ifndef MAP_HUGE_SHIFT
+#define MAP_HUGE_SHIFT 26
+#endif
+
+// from linux/mempolicy.h
+#define SORT_MPOL_INTERLEAVE 3
+
+static std::mutex sMutex;
+static MemoryPolicy sPolicy;
+// mapped length of every mapped buffer, huge page mappings are rounded up
+static std::map<void*, size_t> sMapped;
+static size_t sFallbacks = 0;
+
+/**
+ * @brief Returns the mask of the online NUMA nodes, 0 if unknown.
+ * 
+ * @return unsigned long - node mask
+ */
+static unsigned long OnlineNodes() {
+    static unsigned long mask = []() {
+        unsigned long m = 0;
+        std::ifstream in("/sys/devices/system/node/online");
+        std::string range;
+        // e.g. "0-1,3"
+        while (std::getline(in, range, ',')) {
+            size_t dash = range.find('-');
+            int first = std::stoi(range);
+            int last = dash == std::string::npos ? first : std::stoi(range.substr(dash + 1));
+            for (int node = first; node <= last && node < 64; node++)
+                m |= 1ul << node;
+        }
+        return m;
+    }();
+    return mask;
+}
+
+/**
+ * @brief Maps an anonymous buffer with the page size and placement.
+ * 
+ * @param bytes - requested size
+ * @param pages - page size
+ * @param placement - NUMA placement
+ * @param len - mapped length
+ * @return void* - mapped buffer, nullptr on failure
+ */
+static void* MapBuffer(size_t bytes, PageSize pages, Placement placement, size_t& len) {
+    static bool warned = false;
+    const int flags = MAP_PRIVATE | MAP_ANONYMOUS;
+    void* p = MAP_FAILED;
+
+#ifdef MAP_HUGETLB
+    if (pages == PageSize::Huge2M || pages == PageSize::Huge1G) {
+        int shift = pages == PageSize::Huge1G ? 30 : 21;
+        len = (bytes + (1ul << shift) - 1) & ~((1ul << shift) - 1);
+        p = mmap(nullptr, len, PROT_READ | PROT_WRITE,
+                 flags | MAP_HUGETLB | (shift << MAP_HUGE_SHIFT), -1, 0);
+        if (p == MAP_FAILED) {
+            std::lock_guard<std::mutex> lock(sMutex);
+            sFallbacks++;
+            if (!warned)
+                std::cerr << "No reserved huge pages, using transparent huge pages" << std::endl;
+            warned = true;
+        }
+    }
+#endif
+
+    if (p == MAP_FAILED) {
+        const size_t huge = 2 << 20;
+        bool small = pages == PageSize::System || pages == PageSize::Small4K;
+        len = small ? (bytes + 4095) & ~4095ul : (bytes + huge - 1) & ~(huge - 1);
+        p = mmap(nullptr, len, PROT_READ | PROT_WRITE, flags, -1, 0);
+        if (p == MAP_FAILED)
+            return nullptr;
+#if defined(MADV_HUGEPAGE) && defined(MADV_NOHUGEPAGE)
+        // the system policy keeps whatever the kernel setting decides
+        if (pages != PageSize::System)
+            madvise(p, len, small ? MADV_NOHUGEPAGE : MADV_HUGEPAGE);
+#endif
+    }
+
+#ifdef SYS_mbind
+    unsigned long nodes = OnlineNodes();
+    if (placement == Placement::Interleave && (nodes & (nodes - 1)))
+        syscall(SYS_mbind, p, len, SORT_MPOL_INTERLEAVE, &nodes, 8 * sizeof(nodes) + 1, 0);
+#endif
+    AllocCounter::Record(bytes);
+    return p;
+}
+
+std::string MemoryPolicy::Name() const {
+    std::string name = mPages == PageSize::Huge1G ? "1g"
+                     : mPages == PageSize::Huge2M ? "2m"
+                     : mPages == PageSize::Small4K ? "4k" : "system";
+    return mPlacement == Placement::Interleave ? name + "-interleave" : name;
+}
+
+MemoryPolicy MemoryPolicy::Parse(const std::string& name) {
+    MemoryPolicy policy;
+    std::istringstream in(name);
+    for (std::string part; std::getline(in, part, '-');) {
+        if (part == "4k")
+            policy.mPages = PageSize::Small4K;
+        else if (part == "2m")
+            policy.mPages = PageSize::Huge2M;
+        else if (part == "1g")
+            policy.mPages = PageSize::Huge1G;
+        else if (part == "interleave")
+            policy.mPlacement = Placement::Interleave;
+    }
+    return policy;
+}
+
+void Memory::SetPolicy(const MemoryPolicy& policy) {
+    std::lock_guard<std::mutex> lock(sMutex);
+    sPolicy = policy;
+}
+
+MemoryPolicy Memory::GetPolicy() {
+    std::lock_guard<std::mutex> lock(sMutex);
+    return sPolicy;
+}
+
+void* Memory::Allocate(size_t bytes) {
+    if (bytes < kMapThreshold)
+        return ::operator new(bytes);
+
+    MemoryPolicy policy = GetPolicy();
+    size_t len;
+    void* p = MapBuffer(bytes, policy.mPages, policy.mPlacement, len);
+    if (!p)
+        throw std::bad_alloc();
+    std::lock_guard<std::mutex> lock(sMutex);
+    sMapped[p] = len;
+    return p;
+}
+
+void Memory::Free(void* p, size_t bytes) {
+    if (bytes < kMapThreshold) {
+        ::operator delete(p);
+        return;
+    }
+    size_t len;
+    {
+        std::lock_guard<std::mutex> lock(sMutex);
+        auto it = sMapped.find(p);
+        if (it == sMapped.end())
+            return;
+        len = it->second;
+        sMapped.erase(it);
+    }
+    munmap(p, len);
+}
+
+bool Memory::HugePagesAvailable(PageSize pages) {
+#ifdef MAP_HUGETLB
+    int shift = pages == PageSize::Huge1G ? 30 : 21;
+    void* p = mmap(nullptr, 1ul << shift, PROT_READ | PROT_WRITE,
+                   MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB | (shift << MAP_HUGE_SHIFT), -1, 0);
+    if (p == MAP_FAILED)
+        return false;
+    munmap(p, 1ul << shift);
+    return true;
+#else
+    (void)pages;
+    return false;
+#endif
+}
+
+size_t Memory::HugePageFallbacks() {
+    std::lock_guard<std::mutex> lock(sMutex);
+    return sFallbacks;
+}
+
+/**
+ * @brief Scratch buffer owned by one thread.
+ * 
+ */
+struct ScratchArena {
+    int* mData = nullptr;
+    size_t mSize = 0;
+    size_t mMapped = 0;
+
+    ~ScratchArena() {
+        Release();
+    }
+
+    void Release() {
+        if (mMapped)
+            munmap(mData, mMapped);
+        else
+            delete[] mData;
+        mData = nullptr;
+        mSize = mMapped = 0;
+    }
+};
+
+int* Memory::Scratch(size_t n) {
+    thread_local ScratchArena arena;
+    if (n <= arena.mSize)
+        return arena.mData;
+
+    // grow geometrically, the merges of one sort ask for increasing sizes
+    size_t size = std::max(n, 2 * arena.mSize);
+    arena.Release();
+    if (size * sizeof(int) < kMapThreshold) {
+        arena.mData = new int[size];
+    } else {
+        // never interleaved, the owning thread touches it first
+        arena.mData = static_cast<int*>(MapBuffer(size * sizeof(int), GetPolicy().mPages,
+                                                  Placement::FirstTouch, arena.mMapped));
+        if (!arena.mData)
+            throw std::bad_alloc();
+    }
+    arena.mSize = size;
+    return arena.mData;
+}
@@ -0,0 +1,155 @@
+#ifndef __jch_Memory_hpp__
+#define __jch_Memory_hpp__
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+/**
+ * @brief Page size backing the large buffers.
+ * System leaves the choice to the kernel transparent huge page setting,
+ * Small4K disables transparent huge pages, Huge2M and Huge1G use hugetlbfs
+ * pages and fall back to transparent huge pages when none are reserved.
+ */
+enum class PageSize { System, Small4K, Huge2M, Huge1G };
+
+/**
+ * @brief NUMA placement of the large buffers.
+ * FirstTouch leaves the page on the node of the thread touching it first,
+ * Interleave spreads the pages round robin over all online nodes.
+ */
+enum class Placement { FirstTouch, Interleave };
+
+/**
+ * @brief Memory policy of the framework working buffers.
+ * 
+ */
+struct MemoryPolicy {
+    PageSize mPages = PageSize::System;
+    Placement mPlacement = Placement::FirstTouch;
+
+    /**
+     * @brief Returns the policy name, e.g. "2m-interleave"
+     * 
+     * @return std::string - name of the policy
+     */
+    std::string Name() const;
+
+    /**
+     * @brief Parses "<system|4k|2m|1g>[-interleave]", unknown parts keep the defaults.
+     * 
+     * @param name - name of the policy
+     * @return MemoryPolicy - parsed policy
+     */
+    static MemoryPolicy Parse(const std::string& name);
+};
+
+namespace Memory {
+    /**
+     * @brief Allocations of at least this size are mapped according to
+     * the memory policy, smaller ones use the default allocator.
+     * 
+     */
+    const size_t kMapThreshold = 1 << 20;
+
+    /**
+     * @brief Sets the process wide memory policy used by new allocations.
+     * 
+     * @param policy - memory policy
+     */
+    void SetPolicy(const MemoryPolicy& policy);
+
+    /**
+     * @brief Get the process wide memory policy
+     * 
+     * @return MemoryPolicy - current memory policy
+     */
+    MemoryPolicy GetPolicy();
+
+    /**
+     * @brief Allocates a buffer according to the current memory policy.
+     * 
+     * @param bytes - size of the buffer
+     * @return void* - allocated buffer
+     */
+    void* Allocate(size_t bytes);
+
+    /**
+     * @brief Frees a buffer returned by Allocate.
+     * 
+     * @param p - allocated buffer
+     * @param bytes - size passed to Allocate
+     */
+    void Free(void* p, size_t bytes);
+
+    /**
+     * @brief Checks that a hugetlbfs page of the size can be mapped.
+     * 
+     * @param pages - page size, Huge2M or Huge1G
+     * @return true - at least one page is reserved and free
+     * @return false - the pool is empty, buffers would fall back
+     */
+    bool HugePagesAvailable(PageSize pages);
+
+    /**
+     * @brief Get the number of hugetlbfs buffers which fell back to
+     * transparent huge pages since the start of the process.
+     * 
+     * @return size_t - number of fallbacks
+     */
+    size_t HugePageFallbacks();
+
+    /**
+     * @brief Returns the scratch arena of the calling thread.
+     * The arena uses the page size of the current policy but is always
+     * placed on the node of the calling thread, which touches it first.
+     * Its content is not preserved when it has to grow.
+     * 
+     * @param n - minimal number of elements
+     * @return int* - scratch buffer, valid until the next call in the thread
+     */
+    int* Scratch(size_t n);
+}
+
+/**
+ * @brief Standard allocator drawing from Memory::Allocate.
+ * It is stateless, so vectors can be swapped and moved freely
+ * no matter which policy their buffers were allocated with.
+ * 
+ * @tparam T - element type
+ */
+template <class T>
+struct PolicyAllocator {
+    using value_type = T;
+
+    PolicyAllocator() = default;
+
+    template <class U>
+    PolicyAllocator(const PolicyAllocator<U>&) {}
+
+    T* allocate(size_t n) {
+        return static_cast<T*>(Memory::Allocate(n * sizeof(T)));
+    }
+
+    void deallocate(T* p, size_t n) {
+        Memory::Free(p, n * sizeof(T));
+    }
+};
+
+template <class T, class U>
+bool operator==(const PolicyAllocator<T>&, const PolicyAllocator<U>&) {
+    return true;
+}
+
+template <class T, class U>
+bool operator!=(const PolicyAllocator<T>&, const PolicyAllocator<U>&) {
+    return false;
+}
+
+/**
+ * @brief Vector type of the sorted arrays and their temporaries.
+ * 
+ */
+using IntArray = std::vector<int, PolicyAllocator<int>>;
+
+#endif
@@ -0,0 +1,205 @@
+#include "Metrics.hpp"
+#include "AllocCounter.hpp"
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+using Clock = std::chrono::steady_clock;
+
+MetricsExporter::MetricsExporter(std::string path, int port, double interval) :
+    mPath(path), mPort(port), mInterval(interval), mRunning(false) {}
+
+MetricsExporter::~MetricsExporter() {
+    mRunning = false;
+    if (mThread.joinable())
+        mThread.join();
+}
+
+void MetricsExporter::Start(const std::vector<size_t>& lengths, size_t sorts_per_point) {
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mLengths = lengths;
+        mSortsPerPoint = std::max<size_t>(1, sorts_per_point);
+        mStart = Clock::now();
+    }
+    if (!mRunning) {
+        mRunning = true;
+        mThread = std::thread(&MetricsExporter::Run, this);
+    }
+}
+
+void MetricsExporter::BeginPoint(size_t point) {
+    std::lock_guard<std::mutex> lock(mMutex);
+    mCurrent = point;
+}
+
+void MetricsExporter::RecordTime(const std::string& alg, size_t t) {
+    std::lock_guard<std::mutex> lock(mMutex);
+    mTimes[alg][mCurrent].push_back(t);
+    mLast[alg] = t;
+}
+
+void MetricsExporter::EndPoint() {
+    std::lock_guard<std::mutex> lock(mMutex);
+    mCompleted = mCurrent + 1;
+    mCompletedSeconds = std::chrono::duration<double>(Clock::now() - mStart).count();
+}
+
+std::string MetricsExporter::Render() {
+    std::lock_guard<std::mutex> lock(mMutex);
+    std::ostringstream out;
+    auto gauge = [&out](const char* name, const char* help) {
+        out << "# HELP sorttester_" << name << ' ' << help << std::endl
+            << "# TYPE sorttester_" << name << " gauge" << std::endl;
+    };
+
+    gauge("points_total", "Number of points in the sweep.");
+    out << "sorttester_points_total " << mLengths.size() << std::endl;
+    gauge("points_completed", "Number of finished points.");
+    out << "sorttester_points_completed " << mCompleted << std::endl;
+    gauge("points_remaining", "Number of points left, including the running one.");
+    out << "sorttester_points_remaining " << mLengths.size() - mCompleted << std::endl;
+    gauge("current_point", "Index of the running point.");
+    out << "sorttester_current_point " << mCurrent << std::endl;
+    gauge("current_length", "Vector length of the running point.");
+    out << "sorttester_current_length "
+        << (mCurrent < mLengths.size() ? mLengths[mCurrent] : 0) << std::endl;
+
+    gauge("last_time_nanoseconds", "Last measured sort time of the algorithm.");
+    for (auto const & last: mLast)
+        out << "sorttester_last_time_nanoseconds{algorithm=\"" << last.first << "\"} "
+            << last.second << std::endl;
+    gauge("median_time_nanoseconds", "Median sort time of the algorithm in the running point.");
+    for (auto const & alg: mTimes) {
+        auto it = alg.second.find(mCurrent);
+        if (it == alg.second.end())
+            it = std::prev(alg.second.end());
+        std::vector<size_t> times = it->second;
+        std::nth_element(times.begin(), times.begin() + times.size() / 2, times.end());
+        out << "sorttester_median_time_nanoseconds{algorithm=\"" << alg.first << "\"} "
+            << times[times.size() / 2] << std::endl;
+    }
+
+    gauge("resident_bytes", "Resident set size of the tester.");
+    out << "sorttester_resident_bytes " << ResidentBytes() << std::endl;
+    gauge("elapsed_seconds", "Time since the start of the sweep.");
+    out << "sorttester_elapsed_seconds "
+        << std::chrono::duration<double>(Clock::now() - mStart).count() << std::endl;
+    gauge("eta_seconds", "Estimated time to the end of the sweep, -1 if unknown.");
+    out << "sorttester_eta_seconds " << EstimateRemaining() << std::endl;
+    return out.str();
+}
+
+void MetricsExporter::Run() {
+    // the rendering runs during the sorts, keep it out of their memory usage
+    AllocCounter::Ignore(true);
+    int lfd = -1;
+    if (mPort > 0) {
+        lfd = socket(AF_INET, SOCK_STREAM, 0);
+        int one = 1;
+        setsockopt(lfd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+        sockaddr_in addr = {};
+        addr.sin_family = AF_INET;
+        addr.sin_port = htons(mPort);
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        if (bind(lfd, (sockaddr*)&addr, sizeof(addr)) != 0 || listen(lfd, 8) != 0) {
+            std::cerr << "Metrics port " << mPort << " unavailable" << std::endl;
+            close(lfd);
+            lfd = -1;
+        }
+    }
+
+    Clock::time_point next = Clock::now();
+    while (true) {
+        bool last = !mRunning;
+        if (!mPath.empty() && (last || Clock::now() >= next)) {
+            // write and rename, so a scraper never reads a half written file
+            std::string tmp = mPath + ".tmp";
+            std::ofstream(tmp) << Render();
+            std::rename(tmp.c_str(), mPath.c_str());
+            next = Clock::now() + std::chrono::duration_cast<Clock::duration>(
+                std::chrono::duration<double>(mInterval));
+        }
+        if (last)
+            break;
+
+        pollfd pfd = {lfd, POLLIN, 0};
+        if (lfd < 0 || poll(&pfd, 1, 100) <= 0) {
+            if (lfd < 0)
+                std::this_thread::sleep_for(std::chrono::milliseconds(100));
+            continue;
+        }
+        int fd = accept(lfd, nullptr, nullptr);
+        if (fd < 0)
+            continue;
+        // a silent client must not stall the periodic file updates
+        pollfd cfd = {fd, POLLIN, 0};
+        char req[1024];
+        if (poll(&cfd, 1, 100) <= 0 || read(fd, req, sizeof(req)) <= 0) {
+            close(fd);
+            continue;
+        }
+        std::string body = Render();
+        std::string resp = "HTTP/1.0 200 OK\r\nContent-Type: text/plain; version=0.0.4\r\n"
+                           "Content-Length: " + std::to_string(body.size()) + "\r\n\r\n" + body;
+        ssize_t w = write(fd, resp.data(), resp.size());
+        (void)w;
+        close(fd);
+    }
+    if (lfd >= 0)
+        close(lfd);
+}
+
+double MetricsExporter::EstimateRemaining() const {
+    if (mCompleted == 0 || mLengths.empty())
+        return -1;
+
+    // predicted sort time of every point from log t = log a + b log len
+    std::vector<double> predicted(mLengths.size(), 0);
+    for (auto const & alg: mTimes) {
+        double sx = 0, sy = 0, sxx = 0, sxy = 0, cnt = 0;
+        for (auto const & point: alg.second) {
+            if (point.first >= mCompleted)
+                continue;
+            std::vector<size_t> times = point.second;
+            std::nth_element(times.begin(), times.begin() + times.size() / 2, times.end());
+            double x = std::log((double)mLengths[point.first]);
+            double y = std::log(std::max<double>(1, times[times.size() / 2]));
+            sx += x; sy += y; sxx += x * x; sxy += x * y; cnt++;
+        }
+        if (cnt == 0)
+            continue;
+        double b = cnt > 1 && cnt * sxx - sx * sx > 0 ?
+                   (cnt * sxy - sx * sy) / (cnt * sxx - sx * sx) : 1;
+        double a = (sy - b * sx) / cnt;
+        for (size_t p = 0; p < mLengths.size(); p++)
+            predicted[p] += std::exp(a + b * std::log((double)mLengths[p])) * mSortsPerPoint;
+    }
+
+    // the model misses the copies and the generation, scale it by the
+    // ratio of the real and the predicted time of the finished points
+    double done = 0, left = 0;
+    for (size_t p = 0; p < mLengths.size(); p++)
+        (p < mCompleted ? done : left) += predicted[p];
+    if (done <= 0)
+        return -1;
+    double running = std::chrono::duration<double>(Clock::now() - mStart).count()
+                     - mCompletedSeconds;
+    return std::max(0.0, mCompletedSeconds * left / done - running);
+}
+
+size_t MetricsExporter::ResidentBytes() {
+    std::ifstream statm("/proc/self/statm");
+    size_t size = 0, resident = 0;
+    statm >> size >> resident;
+    return resident * sysconf(_SC_PAGESIZE);
+}
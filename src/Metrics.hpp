@@ -0,0 +1,118 @@
+#ifndef __jch_Metrics_hpp__
+#define __jch_Metrics_hpp__
+
+#include <atomic>
+#include <chrono>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+/**
+ * @brief Live progress of a test sweep in the Prometheus text format.
+ * A background thread periodically rewrites the metrics file and, if
+ * a port is given, serves the same text over HTTP on localhost.
+ * 
+ */
+class MetricsExporter {
+public:
+    /**
+     * @brief Construct a new MetricsExporter object
+     * 
+     * @param path - metrics file, empty to disable the file
+     * @param port - localhost HTTP port, 0 to disable the server
+     * @param interval - seconds between two file updates
+     */
+    MetricsExporter(std::string path, int port = 0, double interval = 5);
+
+    /**
+     * @brief Stops the background thread and writes the final metrics.
+     * 
+     */
+    ~MetricsExporter();
+
+    /**
+     * @brief Sets the sweep plan and starts the background thread.
+     * 
+     * @param lengths - vector lengths of all the sweep points
+     * @param sorts_per_point - number of sorts of one algorithm in one point
+     */
+    void Start(const std::vector<size_t>& lengths, size_t sorts_per_point);
+
+    /**
+     * @brief Marks the start of the point with the given index.
+     * 
+     * @param point - index of the point in the plan
+     */
+    void BeginPoint(size_t point);
+
+    /**
+     * @brief Records one measured time of an algorithm in the current point.
+     * 
+     * @param alg - algorithm name
+     * @param t - time of one sort in nanoseconds
+     */
+    void RecordTime(const std::string& alg, size_t t);
+
+    /**
+     * @brief Marks the end of the current point.
+     * 
+     */
+    void EndPoint();
+
+    /**
+     * @brief Renders the current metrics.
+     * 
+     * @return std::string - metrics in the Prometheus text format
+     */
+    std::string Render();
+
+private:
+    /**
+     * @brief Background thread body, writes the file and serves HTTP.
+     * 
+     */
+    void Run();
+
+    /**
+     * @brief Estimates the remaining time from a power law t = a*len^b
+     * fitted to the measured points of every algorithm.
+     * Must be called with mMutex locked.
+     * 
+     * @return double - estimated remaining seconds, -1 if unknown
+     */
+    double EstimateRemaining() const;
+
+    /**
+     * @brief Returns the resident set size of the process.
+     * 
+     * @return size_t - RSS in bytes
+     */
+    static size_t ResidentBytes();
+
+private:
+    std::string mPath;
+    int mPort;
+    double mInterval;
+
+    std::mutex mMutex;
+    std::vector<size_t> mLengths;
+    size_t mSortsPerPoint = 1;
+    size_t mCurrent = 0;
+    size_t mCompleted = 0;
+    double mCompletedSeconds = 0;
+    std::chrono::steady_clock::time_point mStart;
+
+    /**
+     * @brief Measured times of every algorithm, mTimes[alg][point].
+     * 
+     */
+    std::map<std::string, std::map<size_t, std::vector<size_t>>> mTimes;
+    std::map<std::string, size_t> mLast;
+
+    std::atomic<bool> mRunning;
+    std::thread mThread;
+};
+
+#endif
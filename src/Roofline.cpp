@@ -0,0 +1,135 @@
+#include "Roofline.hpp"
+
+#include <unistd.h>
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <thread>
+#include <vector>
+
+using Clock = std::chrono::steady_clock;
+
+/**
+ * @brief Runs fn(begin, end) over [0, n) split evenly among th threads.
+ * 
+ * @return double - wall time in nanoseconds
+ */
+static double TimeSplit(unsigned th, size_t n,
+                        const std::function<void(size_t, size_t)>& fn) {
+    std::vector<std::thread> threads;
+    Clock::time_point start = Clock::now();
+    for (unsigned t = 1; t < th; t++)
+        threads.emplace_back(fn, n * t / th, n * (t + 1) / th);
+    fn(0, n / th);
+    for (auto & t: threads)
+        t.join();
+    return std::chrono::duration<double, std::nano>(Clock::now() - start).count();
+}
+
+double MachineProfile::Roof(unsigned th) const {
+    double single = std::max({mCopy[0], mScale[0], mTriad[0]});
+    double all = std::max({mCopy[1], mScale[1], mTriad[1]});
+    return std::min(all, single * std::max(1u, th));
+}
+
+MachineProfile Roofline::Calibrate(size_t elements, size_t trials) {
+    if (elements == 0) {
+        elements = std::max<size_t>(4 * LastLevelCache() / sizeof(double), 1 << 22);
+        elements = std::min<size_t>(elements, 1 << 24);
+    }
+
+    MachineProfile m;
+    m.mCacheBytes = LastLevelCache();
+    m.mThreads = std::max(1u, std::thread::hardware_concurrency());
+    std::cout << "Calibrating memory roofline..." << std::endl;
+    Stream(m, 0, 1, elements, trials);
+    Stream(m, 1, m.mThreads, elements, trials);
+    m.mLatency[0] = Latency(elements, 1);
+    m.mLatency[1] = Latency(elements, m.mThreads);
+    std::cout << "Triad: " << m.mTriad[0] << " GB/s (1 thread), " << m.mTriad[1]
+              << " GB/s (" << m.mThreads << " threads), latency: "
+              << m.mLatency[0] << " ns" << std::endl;
+    return m;
+}
+
+size_t Roofline::LastLevelCache() {
+    long llc = sysconf(_SC_LEVEL3_CACHE_SIZE);
+    if (llc <= 0)
+        llc = sysconf(_SC_LEVEL2_CACHE_SIZE);
+    return std::max(llc, 0L);
+}
+
+void Roofline::Export(const MachineProfile& m, const std::string& path) {
+    std::ofstream csv;
+    csv.open(path);
+    csv << ",threads,copy,scale,triad,latency,last level cache" << std::endl;
+    for (int i = 0; i < 2; i++)
+        csv << (i == 0 ? "Single Thread" : "All Threads") << ','
+            << (i == 0 ? 1 : m.mThreads) << ',' << m.mCopy[i] << ',' << m.mScale[i] << ','
+            << m.mTriad[i] << ',' << m.mLatency[i] << ',' << m.mCacheBytes << std::endl;
+    csv.close();
+}
+
+void Roofline::Stream(MachineProfile& m, int idx, unsigned th,
+                      size_t elements, size_t trials) {
+    std::unique_ptr<double[]> a(new double[elements]);
+    std::unique_ptr<double[]> b(new double[elements]);
+    std::unique_ptr<double[]> c(new double[elements]);
+    const double s = 3.0;
+
+    // first touch by the threads which run the kernels
+    TimeSplit(th, elements, [&](size_t l, size_t r) {
+        std::fill(a.get() + l, a.get() + r, 1.0);
+        std::fill(b.get() + l, b.get() + r, 2.0);
+        std::fill(c.get() + l, c.get() + r, 0.0);
+    });
+
+    double copy = 1e300, scale = 1e300, triad = 1e300;
+    for (size_t t = 0; t < trials; t++) {
+        copy = std::min(copy, TimeSplit(th, elements, [&](size_t l, size_t r) {
+            for (size_t i = l; i < r; i++)
+                c[i] = a[i];
+        }));
+        scale = std::min(scale, TimeSplit(th, elements, [&](size_t l, size_t r) {
+            for (size_t i = l; i < r; i++)
+                b[i] = s * c[i];
+        }));
+        triad = std::min(triad, TimeSplit(th, elements, [&](size_t l, size_t r) {
+            for (size_t i = l; i < r; i++)
+                a[i] = b[i] + s * c[i];
+        }));
+    }
+    // the arrays are read back, so the optimizer cannot drop the kernels
+    volatile double sink = a[elements / 2] + b[elements / 3] + c[elements - 1];
+    (void)sink;
+    double bytes = elements * sizeof(double);
+    m.mCopy[idx] = 2 * bytes / copy;
+    m.mScale[idx] = 2 * bytes / scale;
+    m.mTriad[idx] = 3 * bytes / triad;
+}
+
+double Roofline::Latency(size_t elements, unsigned th) {
+    // Sattolo's algorithm gives a single cycle through all the slots
+    std::vector<size_t> next(elements);
+    for (size_t i = 0; i < elements; i++)
+        next[i] = i;
+    std::mt19937_64 gen(42);
+    for (size_t i = elements - 1; i > 0; i--)
+        std::swap(next[i], next[gen() % i]);
+
+    const size_t steps = 1 << 22;
+    std::vector<size_t> sink(th);
+    double t = TimeSplit(th, th, [&](size_t l, size_t r) {
+        for (size_t id = l; id < r; id++) {
+            size_t p = id * (elements / th);
+            for (size_t i = 0; i < steps; i++)
+                p = next[p];
+            sink[id] = p;
+        }
+    });
+    return t / steps;
+}
@@ -0,0 +1,84 @@
+#ifndef __jch_Roofline_hpp__
+#define __jch_Roofline_hpp__
+
+#include <cstddef>
+#include <string>
+
+/**
+ * @brief Memory limits of the machine measured at startup.
+ * Bandwidths are in bytes per nanosecond (GB/s).
+ * 
+ */
+struct MachineProfile {
+    double mCopy[2];        ///< STREAM copy, [0] single thread, [1] all threads
+    double mScale[2];       ///< STREAM scale
+    double mTriad[2];       ///< STREAM triad
+    double mLatency[2];     ///< random access latency in nanoseconds
+    unsigned mThreads;      ///< number of threads of the all-thread runs
+    size_t mCacheBytes;     ///< size of the last level cache, 0 if unknown
+
+    /**
+     * @brief Returns the bandwidth roof for an algorithm running on th threads.
+     * 
+     * @param th - number of threads of the algorithm
+     * @return double - best sustainable bandwidth in bytes per nanosecond
+     */
+    double Roof(unsigned th) const;
+};
+
+/**
+ * @brief STREAM-style bandwidth and pointer chasing latency calibration.
+ * 
+ */
+class Roofline {
+public:
+    /**
+     * @brief Measures the machine profile.
+     * 
+     * @param elements - number of doubles in each STREAM array, 0 selects
+     * four times the last level cache
+     * @param trials - number of repetitions, the best one is kept
+     * @return MachineProfile - measured profile
+     */
+    static MachineProfile Calibrate(size_t elements = 0, size_t trials = 5);
+
+    /**
+     * @brief Exports the machine profile into a csv file.
+     * 
+     * @param m - machine profile
+     * @param path - path of the output file
+     */
+    static void Export(const MachineProfile& m, const std::string& path);
+
+    /**
+     * @brief Returns the size of the last level cache.
+     * 
+     * @return size_t - size in bytes, 0 if unknown
+     */
+    static size_t LastLevelCache();
+
+private:
+    /**
+     * @brief Runs the STREAM kernels on th threads.
+     * 
+     * @param m - profile the bandwidths are stored into
+     * @param idx - 0 for the single thread run, 1 for the all-thread run
+     * @param th - number of threads
+     * @param elements - number of doubles in each array
+     * @param trials - number of repetitions
+     */
+    static void Stream(MachineProfile& m, int idx, unsigned th,
+                       size_t elements, size_t trials);
+
+    /**
+     * @brief Measures the random access latency by chasing pointers
+     * through a random cyclic permutation on th threads.
+     * 
+     * @param elements - number of pointers in the chased buffer
+     * @param th - number of threads chasing at once
+     * @return double - latency of one access in nanoseconds
+     */
+    static double Latency(size_t elements, unsigned th);
+};
+
+#endif
@@ -0,0 +1,144 @@
+#include "Scaling.hpp"
+#include "TesterFramework.hpp"
+
+#include <sched.h>
+#include <thread>
+#include <iomanip>
+
+ScalingTester::ScalingTester(bool pin) :
+    mPin(pin), mMaxThreads(std::max(1u, std::thread::hardware_concurrency())) {
+    // cpus the process may run on, a cpuset or container can exclude some
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    if (sched_getaffinity(0, sizeof(set), &set) == 0) {
+        for (int c = 0; c < CPU_SETSIZE; c++)
+            if (CPU_ISSET(c, &set))
+                mAllowedCpus.push_back(c);
+    }
+    if (!mAllowedCpus.empty())
+        mMaxThreads = std::min<uint>(mMaxThreads, mAllowedCpus.size());
+}
+
+void ScalingTester::AddAlg(std::unique_ptr<AbstractSort> seq, ThreadedSortFactory par) {
+    mSeqAlgs.push_back(std::move(seq));
+    mParAlgs.push_back(par);
+}
+
+void ScalingTester::StartScaling(const std::vector<size_t>& lengths,
+                                 size_t repeat_test) {
+    for (size_t len: lengths) {
+        std::cout << "Scaling length: " << len << std::endl;
+        std::vector<int> arr(len);
+        std::generate(arr.begin(), arr.end(), [len]() { return rand() % (2 * len); });
+
+        for (size_t a = 0; a < mSeqAlgs.size(); a++) {
+            ScalingEntry e;
+            PinThreads(1);
+            e.mSequentialTime = Measure(*mSeqAlgs[a], arr, repeat_test);
+            e.mNumOfElements = len;
+            for (uint p = 1; p <= mMaxThreads; p++) {
+                std::unique_ptr<AbstractSort> alg = mParAlgs[a](p);
+                e.mName = alg->GetName();
+                PinThreads(p);
+                e.mTimes.push_back(Measure(*alg, arr, repeat_test));
+            }
+            PinThreads(0);
+            // the names carry the thread count, keep just the algorithm
+            e.mName = e.mName.substr(0, e.mName.rfind(" (mt"));
+            FitSerialFraction(e);
+            mResults.push_back(e);
+        }
+    }
+
+    std::cout << "SCALING DONE!" << std::endl;
+    PrintRecommendation();
+    ExportData();
+}
+
+size_t ScalingTester::Measure(AbstractSort& alg, const std::vector<int>& arr,
+                              size_t rep) {
+    std::vector<size_t> times;
+    for (size_t i = 0; i < rep; i++) {
+        alg.SetArray(arr);
+
+        time_point<Clock> start = Clock::now();
+        alg.Sort();
+        time_point<Clock> end = Clock::now();
+
+        times.push_back(duration_cast<nanoseconds>(end - start).count());
+    }
+    std::sort(times.begin(), times.end());
+    return times[times.size() / 2];
+}
+
+void ScalingTester::PinThreads(uint th) {
+    if (!mPin)
+        return;
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    uint cores = th == 0 ? mMaxThreads : th;
+    if (mAllowedCpus.size() < cores) {
+        std::cerr << "Only " << mAllowedCpus.size() << " cpus allowed, cannot pin to "
+                  << cores << std::endl;
+        return;
+    }
+    for (uint c = 0; c < cores; c++)
+        CPU_SET(mAllowedCpus[c], &set);
+    // threads spawned by std::async inherit the affinity of their creator
+    if (sched_setaffinity(0, sizeof(set), &set) != 0)
+        std::cerr << "Pinning to " << cores << " cores failed" << std::endl;
+}
+
+void ScalingTester::FitSerialFraction(ScalingEntry& e) {
+    // Amdahl: 1/S = f + (1-f)/p  =>  1/S - 1/p = f * (1 - 1/p)
+    // the lengths are fixed (strong scaling), so Gustafson's law does not apply
+    double an = 0, ad = 0;
+    for (uint p = 2; p <= e.mTimes.size(); p++) {
+        double s = (double)e.mSequentialTime / e.mTimes[p-1];
+        double x = 1.0 / p;
+        an += (1 - x) * (1 / s - x);
+        ad += (1 - x) * (1 - x);
+    }
+    e.mAmdahlSerial = ad > 0 ? an / ad : 1;
+}
+
+void ScalingTester::PrintRecommendation() const {
+    std::cout << std::left << std::setw(12) << "n" << std::setw(8) << "cores"
+              << std::setw(28) << "best algorithm" << "speedup" << std::endl;
+    for (size_t i = 0; i < mResults.size(); i += mSeqAlgs.size()) {
+        for (uint p = 1; p <= mMaxThreads; p++) {
+            const ScalingEntry* best = &mResults[i];
+            for (size_t a = i; a < i + mSeqAlgs.size(); a++) {
+                if (mResults[a].mTimes[p-1] < best->mTimes[p-1])
+                    best = &mResults[a];
+            }
+            std::cout << std::setw(12) << best->mNumOfElements << std::setw(8) << p
+                      << std::setw(28) << best->mName << std::setprecision(3)
+                      << (double)best->mSequentialTime / best->mTimes[p-1] << std::endl;
+        }
+    }
+}
+
+void ScalingTester::ExportData() const {
+    std::ofstream csv;
+    csv.open("output-data/scaling.csv");
+    csv << "algorithm,n,threads,time,speedup,efficiency" << std::endl;
+    for (auto const & e: mResults) {
+        for (uint p = 1; p <= e.mTimes.size(); p++) {
+            double s = (double)e.mSequentialTime / e.mTimes[p-1];
+            csv << e.mName << ',' << e.mNumOfElements << ',' << p << ','
+                << e.mTimes[p-1] << ',' << s << ',' << s / p << std::endl;
+        }
+    }
+    csv.close();
+
+    csv.open("output-data/scaling-fit.csv");
+    csv << "algorithm,n,sequential time,amdahl serial fraction,best threads" << std::endl;
+    for (auto const & e: mResults) {
+        size_t best = std::min_element(e.mTimes.begin(), e.mTimes.end())
+                      - e.mTimes.begin() + 1;
+        csv << e.mName << ',' << e.mNumOfElements << ',' << e.mSequentialTime << ','
+            << e.mAmdahlSerial << ',' << best << std::endl;
+    }
+    csv.close();
+}
@@ -0,0 +1,106 @@
+#ifndef __jch_Scaling_hpp__
+#define __jch_Scaling_hpp__
+
+#include <functional>
+#include <memory>
+#include <vector>
+
+#include "Sorting.hpp"
+
+/**
+ * @brief Creates a parallel sorting algorithm for the given number of threads.
+ * 
+ */
+using ThreadedSortFactory = std::function<std::unique_ptr<AbstractSort>(uint)>;
+
+/**
+ * @brief Results of one parallel algorithm on one array length.
+ * 
+ */
+struct ScalingEntry {
+    std::string mName;
+    size_t mNumOfElements;
+    size_t mSequentialTime;
+    std::vector<size_t> mTimes;     ///< mTimes[p-1] - time on p threads
+    double mAmdahlSerial;           ///< serial fraction fitted by Amdahl's law
+};
+
+/**
+ * @brief Framework for measuring how the parallel sorting algorithms
+ * scale with the number of threads.
+ * 
+ */
+class ScalingTester {
+public:
+    /**
+     * @brief Construct a new ScalingTester object
+     * 
+     * @param pin - pin the p threads of a run to the first p allowed cpus
+     */
+    ScalingTester(bool pin = false);
+
+    /**
+     * @brief Adds a parallel algorithm and its sequential counterpart.
+     * 
+     * @param seq - sequential algorithm the speedup is computed against
+     * @param par - factory of the parallel algorithm
+     */
+    void AddAlg(std::unique_ptr<AbstractSort> seq, ThreadedSortFactory par);
+
+    /**
+     * @brief Runs every parallel algorithm on 1 to the number of allowed cpus
+     * threads for each of the given lengths.
+     * 
+     * @param lengths - lengths of the tested vectors
+     * @param repeat_test - number of test repetitions, the median is used
+     */
+    void StartScaling(const std::vector<size_t>& lengths, size_t repeat_test = 15);
+
+private:
+    /**
+     * @brief Measures the median time of sorting arr.
+     * 
+     * @param alg - tested algorithm
+     * @param arr - vector to be sorted
+     * @param rep - number of test repetitions
+     * @return size_t - median time in nanoseconds
+     */
+    size_t Measure(AbstractSort& alg, const std::vector<int>& arr, size_t rep);
+
+    /**
+     * @brief Restricts the calling thread and the threads it creates
+     * to the first th cpus of the affinity mask (no-op unless pinning is enabled).
+     * 
+     * @param th - number of cores, 0 allows all of them
+     */
+    void PinThreads(uint th);
+
+    /**
+     * @brief Fits the serial fraction of the entry by Amdahl's law.
+     * 
+     * @param e - measured entry
+     */
+    void FitSerialFraction(ScalingEntry& e);
+
+    /**
+     * @brief Prints which algorithm and how many threads to use for each length.
+     * 
+     */
+    void PrintRecommendation() const;
+
+    /**
+     * @brief Exports the scaling results into csv files for further analysis
+     * 
+     */
+    void ExportData() const;
+
+private:
+    bool mPin;
+    uint mMaxThreads;
+    std::vector<int> mAllowedCpus;
+    std::vector<std::unique_ptr<AbstractSort>> mSeqAlgs;
+    std::vector<ThreadedSortFactory> mParAlgs;
+    std::vector<ScalingEntry> mResults;
+};
+
+#endif
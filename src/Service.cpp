@@ -0,0 +1,318 @@
+#include "Service.hpp"
+
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <poll.h>
+#include <unistd.h>
+#include <csignal>
+#include <cstring>
+#include <fstream>
+#include <random>
+
+using Clock = std::chrono::steady_clock;
+
+/**
+ * @brief Reads exactly len bytes from fd.
+ * 
+ * @return true - all bytes were read
+ * @return false - the connection was closed or failed
+ */
+static bool ReadAll(int fd, void* buf, size_t len) {
+    char* p = static_cast<char*>(buf);
+    while (len > 0) {
+        ssize_t r = read(fd, p, len);
+        if (r <= 0)
+            return false;
+        p += r;
+        len -= r;
+    }
+    return true;
+}
+
+/**
+ * @brief Writes exactly len bytes to fd.
+ * 
+ * @return true - all bytes were written
+ * @return false - the connection was closed or failed
+ */
+static bool WriteAll(int fd, const void* buf, size_t len) {
+    const char* p = static_cast<const char*>(buf);
+    while (len > 0) {
+        ssize_t w = write(fd, p, len);
+        if (w <= 0)
+            return false;
+        p += w;
+        len -= w;
+    }
+    return true;
+}
+
+/**
+ * @brief Fills the Unix domain socket address for path.
+ * 
+ */
+static sockaddr_un SocketAddress(const std::string& path) {
+    sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    strncpy(addr.sun_path, path.c_str(), sizeof(addr.sun_path) - 1);
+    return addr;
+}
+
+SortService::Connection::~Connection() {
+    close(mFd);
+}
+
+SortService::SortService(std::string path, SortFactory factory, uint workers,
+                         size_t queue_limit, size_t batch, size_t max_elements) :
+    mPath(path), mFactory(factory), mWorkers(std::max(1u, workers)),
+    mQueueLimit(queue_limit), mBatch(std::max<size_t>(1, batch)),
+    mMaxElements(max_elements), mRunning(false) {}
+
+void SortService::Serve() {
+    signal(SIGPIPE, SIG_IGN);
+    int lfd = socket(AF_UNIX, SOCK_STREAM, 0);
+    sockaddr_un addr = SocketAddress(mPath);
+    unlink(mPath.c_str());
+    if (lfd < 0 || bind(lfd, (sockaddr*)&addr, sizeof(addr)) != 0 || listen(lfd, 128) != 0) {
+        std::cerr << "Cannot listen on " << mPath << ": " << strerror(errno) << std::endl;
+        if (lfd >= 0)
+            close(lfd);
+        return;
+    }
+    std::cout << "Serving on " << mPath << " with " << mWorkers << " workers" << std::endl;
+
+    mRunning = true;
+    std::vector<std::thread> workers;
+    for (uint i = 0; i < mWorkers; i++)
+        workers.emplace_back(&SortService::WorkerLoop, this);
+
+    while (mRunning) {
+        pollfd pfd = {lfd, POLLIN, 0};
+        if (poll(&pfd, 1, 100) <= 0)
+            continue;
+        int fd = accept(lfd, nullptr, nullptr);
+        if (fd < 0)
+            continue;
+        auto conn = std::make_shared<Connection>(fd);
+        {
+            std::lock_guard<std::mutex> lock(mConnMutex);
+            // drop the connections closed since the last accept
+            mConns.erase(std::remove_if(mConns.begin(), mConns.end(),
+                                        [](const std::weak_ptr<Connection>& w) {
+                                            return w.expired();
+                                        }), mConns.end());
+            mConns.push_back(conn);
+            mReaders++;
+        }
+        std::thread([this, conn]() mutable {
+            ReadRequests(conn);
+            conn.reset();
+            // notify under the lock, Serve() may return right after
+            std::lock_guard<std::mutex> lock(mConnMutex);
+            mReaders--;
+            mConnCv.notify_all();
+        }).detach();
+    }
+
+    close(lfd);
+    unlink(mPath.c_str());
+    {
+        // wake up the readers blocked on their sockets
+        std::unique_lock<std::mutex> lock(mConnMutex);
+        for (auto & weak: mConns)
+            if (auto conn = weak.lock())
+                shutdown(conn->mFd, SHUT_RDWR);
+        mConnCv.wait(lock, [this]() { return mReaders == 0; });
+    }
+    {
+        // Stop() runs in a signal handler and cannot lock, so the flag is
+        // set again under the queue lock, a worker between its predicate
+        // check and its wait cannot miss the wakeup
+        std::lock_guard<std::mutex> lock(mQueueMutex);
+        mRunning = false;
+    }
+    mQueueCv.notify_all();
+    for (auto & t: workers)
+        t.join();
+    std::cout << "SERVICE STOPPED!" << std::endl;
+}
+
+void SortService::Stop() {
+    mRunning = false;
+}
+
+void SortService::ReadRequests(std::shared_ptr<Connection> conn) {
+    RequestHeader req;
+    while (ReadAll(conn->mFd, &req, sizeof(req))) {
+        if (req.mNumOfElements > mMaxElements) {
+            // skip the payload, the connection stays usable
+            char sink[4096];
+            size_t left = (size_t)req.mNumOfElements * sizeof(int);
+            while (left > 0 && ReadAll(conn->mFd, sink, std::min(left, sizeof(sink))))
+                left -= std::min(left, sizeof(sink));
+            if (left > 0)
+                break;
+            Respond(*conn, req.mId, 2, {});
+            continue;
+        }
+        Job job = {conn, req.mId, IntArray(req.mNumOfElements)};
+        if (!ReadAll(conn->mFd, job.mArray.data(), job.mArray.size() * sizeof(int)))
+            break;
+
+        std::unique_lock<std::mutex> lock(mQueueMutex);
+        if (mQueue.size() >= mQueueLimit) {
+            lock.unlock();
+            Respond(*conn, req.mId, 1, {});
+            continue;
+        }
+        mQueue.push_back(std::move(job));
+        lock.unlock();
+        mQueueCv.notify_one();
+    }
+}
+
+void SortService::WorkerLoop() {
+    std::unique_ptr<AbstractSort> alg = mFactory();
+    std::vector<Job> batch;
+    while (true) {
+        {
+            std::unique_lock<std::mutex> lock(mQueueMutex);
+            mQueueCv.wait(lock, [this]() { return !mQueue.empty() || !mRunning; });
+            if (mQueue.empty())
+                return;
+            while (!mQueue.empty() && batch.size() < mBatch) {
+                batch.push_back(std::move(mQueue.front()));
+                mQueue.pop_front();
+            }
+        }
+        for (auto & job: batch) {
+            alg->SetArray(std::move(job.mArray));
+            alg->Sort();
+            Respond(*job.mConn, job.mId, 0, alg->GetArray());
+        }
+        batch.clear();
+    }
+}
+
+void SortService::Respond(Connection& conn, uint64_t id, uint32_t status,
+                          const IntArray& arr) {
+    ResponseHeader resp = {id, status, (uint32_t)arr.size()};
+    std::lock_guard<std::mutex> lock(conn.mWriteMutex);
+    if (WriteAll(conn.mFd, &resp, sizeof(resp)))
+        WriteAll(conn.mFd, arr.data(), arr.size() * sizeof(int));
+}
+
+LoadGenerator::LoadGenerator(std::string path, double rate, double seconds,
+                             std::vector<LoadMix> mix, uint connections) :
+    mPath(path), mRate(rate), mSeconds(seconds), mMix(mix),
+    mConnections(std::max(1u, connections)) {}
+
+void LoadGenerator::Run() {
+    signal(SIGPIPE, SIG_IGN);
+    std::vector<int> fds;
+    for (uint i = 0; i < mConnections; i++) {
+        int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+        sockaddr_un addr = SocketAddress(mPath);
+        if (fd < 0 || connect(fd, (sockaddr*)&addr, sizeof(addr)) != 0) {
+            std::cerr << "Cannot connect to " << mPath << ": " << strerror(errno) << std::endl;
+            if (fd >= 0)
+                close(fd);
+            for (int f: fds)
+                close(f);
+            return;
+        }
+        fds.push_back(fd);
+    }
+
+    // the whole schedule and the request arrays are prepared up front
+    std::mt19937_64 gen(std::random_device{}());
+    std::exponential_distribution<double> gap(mRate);
+    std::vector<double> weights;
+    for (auto const & m: mMix)
+        weights.push_back(m.mWeight);
+    std::discrete_distribution<size_t> pick(weights.begin(), weights.end());
+
+    std::vector<std::vector<int>> arrays;
+    for (auto const & m: mMix) {
+        arrays.emplace_back(m.mNumOfElements);
+        std::generate(arrays.back().begin(), arrays.back().end(),
+                      [&]() { return (int)(gen() % (2 * m.mNumOfElements + 1)); });
+    }
+
+    Clock::time_point start = Clock::now() + std::chrono::milliseconds(10);
+    std::vector<size_t> kinds;
+    double t = 0;
+    while ((t += gap(gen)) < mSeconds) {
+        mScheduled.push_back(start + std::chrono::duration_cast<Clock::duration>(
+            std::chrono::duration<double>(t)));
+        kinds.push_back(pick(gen));
+    }
+
+    std::vector<std::thread> readers;
+    for (int fd: fds)
+        readers.emplace_back(&LoadGenerator::ReadResponses, this, fd);
+
+    for (size_t id = 0; id < mScheduled.size(); id++) {
+        std::this_thread::sleep_until(mScheduled[id]);
+        const std::vector<int>& arr = arrays[kinds[id]];
+        RequestHeader req = {id, (uint32_t)arr.size(), 0};
+        int fd = fds[id % fds.size()];
+        if (!WriteAll(fd, &req, sizeof(req)) ||
+            !WriteAll(fd, arr.data(), arr.size() * sizeof(int)))
+            break;
+    }
+    for (int fd: fds)
+        shutdown(fd, SHUT_WR);
+    for (auto & r: readers)
+        r.join();
+    for (int fd: fds)
+        close(fd);
+    double elapsed = std::chrono::duration<double>(Clock::now() - start).count();
+
+    std::sort(mLatencies.begin(), mLatencies.end());
+    double throughput = mLatencies.size() / elapsed;
+    std::cout << "requests: " << mScheduled.size() << " sorted: " << mLatencies.size()
+              << " rejected: " << mRejected << " unsorted: " << mUnsorted << std::endl
+              << "throughput: " << throughput << " req/s" << std::endl
+              << "latency p50: " << Percentile(0.5) << " us, p99: " << Percentile(0.99)
+              << " us, p999: " << Percentile(0.999) << " us" << std::endl;
+
+    std::ofstream csv("output-data/latency.csv", std::ios::app);
+    if (csv.tellp() == 0)
+        csv << "socket,rate,connections,requests,sorted,rejected,throughput,"
+            << "p50,p99,p999" << std::endl;
+    csv << mPath << ',' << mRate << ',' << mConnections << ',' << mScheduled.size() << ','
+        << mLatencies.size() << ',' << mRejected << ',' << throughput << ','
+        << Percentile(0.5) << ',' << Percentile(0.99) << ',' << Percentile(0.999)
+        << std::endl;
+}
+
+void LoadGenerator::ReadResponses(int fd) {
+    ResponseHeader resp;
+    std::vector<int> arr;
+    while (ReadAll(fd, &resp, sizeof(resp))) {
+        arr.resize(resp.mNumOfElements);
+        if (!ReadAll(fd, arr.data(), arr.size() * sizeof(int)))
+            break;
+        Clock::time_point now = Clock::now();
+        if (resp.mId >= mScheduled.size())
+            continue;
+
+        std::lock_guard<std::mutex> lock(mResultMutex);
+        if (resp.mStatus != 0) {
+            mRejected++;
+            continue;
+        }
+        if (!std::is_sorted(arr.begin(), arr.end()))
+            mUnsorted++;
+        mLatencies.push_back(std::chrono::duration<double, std::micro>(
+            now - mScheduled[resp.mId]).count());
+    }
+}
+
+double LoadGenerator::Percentile(double p) const {
+    if (mLatencies.empty())
+        return 0;
+    return mLatencies[std::min(mLatencies.size() - 1, (size_t)(p * mLatencies.size()))];
+}
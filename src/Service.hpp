@@ -0,0 +1,212 @@
+#ifndef __jch_Service_hpp__
+#define __jch_Service_hpp__
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "Sorting.hpp"
+
+/**
+ * @brief Creates a new instance of the served sorting algorithm.
+ * 
+ */
+using SortFactory = std::function<std::unique_ptr<AbstractSort>()>;
+
+/**
+ * @brief Wire format shared by the service and the load generator.
+ * Request:  RequestHeader followed by mNumOfElements int32 values.
+ * Response: ResponseHeader followed by mNumOfElements sorted int32 values
+ *           (none if the request was rejected).
+ */
+struct RequestHeader {
+    uint64_t mId;
+    uint32_t mNumOfElements;
+    uint32_t mReserved;         ///< zero, keeps the header free of implicit padding
+};
+
+struct ResponseHeader {
+    uint64_t mId;
+    uint32_t mStatus;           ///< 0 - sorted, 1 - rejected by admission control, 2 - too large
+    uint32_t mNumOfElements;
+};
+
+// the headers are sent as raw bytes, their layout is the wire format
+static_assert(sizeof(RequestHeader) == 16, "RequestHeader must be 16 bytes");
+static_assert(sizeof(ResponseHeader) == 16, "ResponseHeader must be 16 bytes");
+
+/**
+ * @brief Sort-as-a-service daemon listening on a Unix domain socket.
+ * Requests of all connections go through one bounded queue into a shared
+ * worker pool; every worker owns its own algorithm object and takes up to
+ * a batch of requests per queue access.
+ * 
+ */
+class SortService {
+public:
+    /**
+     * @brief Construct a new SortService object
+     * 
+     * @param path - path of the Unix domain socket
+     * @param factory - creates the algorithm of one worker
+     * @param workers - number of worker threads
+     * @param queue_limit - queued requests above which new ones are rejected
+     * @param batch - maximal number of requests a worker takes at once
+     * @param max_elements - largest accepted request, larger ones are rejected
+     */
+    SortService(std::string path, SortFactory factory, uint workers,
+                size_t queue_limit = 1024, size_t batch = 8,
+                size_t max_elements = 1 << 24);
+
+    /**
+     * @brief Serves requests until Stop() is called.
+     * 
+     */
+    void Serve();
+
+    /**
+     * @brief Makes Serve() return, safe to call from a signal handler.
+     * 
+     */
+    void Stop();
+
+private:
+    /**
+     * @brief Client connection shared by its reader and the workers.
+     * The socket is closed once the last pending response is sent.
+     */
+    struct Connection {
+        Connection(int fd) : mFd(fd) {}
+        ~Connection();
+
+        int mFd;
+        std::mutex mWriteMutex;
+    };
+
+    /**
+     * @brief One queued sort request.
+     * 
+     */
+    struct Job {
+        std::shared_ptr<Connection> mConn;
+        uint64_t mId;
+        IntArray mArray;
+    };
+
+    /**
+     * @brief Reads the requests of one connection and admits them to the queue.
+     * 
+     * @param conn - client connection
+     */
+    void ReadRequests(std::shared_ptr<Connection> conn);
+
+    /**
+     * @brief Worker thread body, sorts batches of queued requests.
+     * 
+     */
+    void WorkerLoop();
+
+    /**
+     * @brief Sends the response for the request id.
+     * 
+     * @param conn - client connection
+     * @param id - request id
+     * @param status - response status
+     * @param arr - sorted elements
+     */
+    void Respond(Connection& conn, uint64_t id, uint32_t status,
+                 const IntArray& arr);
+
+private:
+    std::string mPath;
+    SortFactory mFactory;
+    uint mWorkers;
+    size_t mQueueLimit;
+    size_t mBatch;
+    size_t mMaxElements;
+
+    std::atomic<bool> mRunning;
+    std::mutex mQueueMutex;
+    std::condition_variable mQueueCv;
+    std::deque<Job> mQueue;
+
+    std::mutex mConnMutex;
+    std::condition_variable mConnCv;
+    std::vector<std::weak_ptr<Connection>> mConns;
+    size_t mReaders = 0;        ///< running reader threads
+};
+
+/**
+ * @brief Share of one array length in the generated load.
+ * 
+ */
+struct LoadMix {
+    size_t mNumOfElements;
+    double mWeight;
+};
+
+/**
+ * @brief Open-loop load generator for the SortService.
+ * Requests are sent on a Poisson schedule regardless of the responses,
+ * latency is measured from the scheduled send time so a stalled service
+ * is not hidden by a stalled generator.
+ * 
+ */
+class LoadGenerator {
+public:
+    /**
+     * @brief Construct a new LoadGenerator object
+     * 
+     * @param path - path of the service Unix domain socket
+     * @param rate - requests per second
+     * @param seconds - duration of the run
+     * @param mix - array lengths and their weights
+     * @param connections - number of connections the requests are spread over
+     */
+    LoadGenerator(std::string path, double rate, double seconds,
+                  std::vector<LoadMix> mix, uint connections = 4);
+
+    /**
+     * @brief Runs the load, prints the latency percentiles and throughput
+     * and appends them to output-data/latency.csv.
+     * 
+     */
+    void Run();
+
+private:
+    /**
+     * @brief Reads the responses of one connection.
+     * 
+     * @param fd - connection socket
+     */
+    void ReadResponses(int fd);
+
+    /**
+     * @brief Returns the p-th percentile of the measured latencies.
+     * 
+     * @param p - percentile in [0, 1]
+     * @return double - latency in microseconds
+     */
+    double Percentile(double p) const;
+
+private:
+    std::string mPath;
+    double mRate;
+    double mSeconds;
+    std::vector<LoadMix> mMix;
+    uint mConnections;
+
+    std::vector<std::chrono::steady_clock::time_point> mScheduled;
+    std::mutex mResultMutex;
+    std::vector<double> mLatencies;
+    size_t mRejected = 0;
+    size_t mUnsorted = 0;
+};
+
+#endif
@@ -1,14 +1,130 @@
 #include "Sorting.hpp"
+#include "Trace.hpp"
+
+#include <unistd.h>
+#include <cmath>
+#include <fstream>
+#include <sstream>
+
+/**
+ * @brief Returns the size of a cache level reported by the system.
+ * 
+ * @param name - sysconf name of the cache level
+ * @param fallback - size used when the system does not report it
+ * @return size_t - cache size in bytes
+ */
+static size_t CacheSize(int name, size_t fallback) {
+    long sz = sysconf(name);
+    return sz > 0 ? sz : fallback;
+}
+
+/**
+ * @brief Tournament tree of losers used for merging k sorted runs.
+ * Inner nodes keep the loser of the match played in them, node 0
+ * keeps the overall winner. Replacing the winner replays only
+ * the log2(k) matches on its path to the root.
+ */
+struct LoserTree {
+    LoserTree(const int* src, const std::vector<size_t>& begins,
+              const std::vector<size_t>& ends)
+        : mSrc(src), mK(begins.size()), mTree(mK, mK),
+          mCur(begins), mEnd(ends) {
+        for (size_t i = mK; i-- > 0;)
+            Replay(i);
+    }
+
+    /**
+     * @brief Run s wins against run t (exhausted runs always lose,
+     * equal keys are taken from the lower run to keep the merge stable).
+     */
+    bool Wins(size_t s, size_t t) const {
+        if (mCur[s] == mEnd[s])
+            return false;
+        if (mCur[t] == mEnd[t])
+            return true;
+        int a = mSrc[mCur[s]], b = mSrc[mCur[t]];
+        return a < b || (a == b && s < t);
+    }
+
+    void Replay(size_t s) {
+        for (size_t t = (s + mK) / 2; t > 0; t /= 2) {
+            if (mTree[t] == mK) {   // first player to reach the node waits
+                mTree[t] = s;
+                return;
+            }
+            if (Wins(mTree[t], s))
+                std::swap(mTree[t], s);
+        }
+        mTree[0] = s;
+    }
+
+    /**
+     * @brief Returns the smallest element and advances its run.
+     */
+    int Pop() {
+        size_t w = mTree[0];
+        int val = mSrc[mCur[w]++];
+        Replay(w);
+        return val;
+    }
+
+    const int* mSrc;
+    size_t mK;
+    std::vector<size_t> mTree;
+    std::vector<size_t> mCur;
+    std::vector<size_t> mEnd;
+};
+
+/**
+ * @brief Runs fn(i) for every i in [0, cnt) on up to th threads,
+ * the tasks are claimed one by one through an atomic counter.
+ * 
+ * @param th - number of threads including the calling one
+ * @param cnt - number of tasks
+ * @param fn - task body
+ */
+static void RunParallel(uint th, size_t cnt, const std::function<void(size_t)>& fn) {
+    std::atomic<size_t> next(0);
+    auto worker = [&]() {
+        for (size_t i = next++; i < cnt; i = next++)
+            fn(i);
+    };
+    std::vector<std::future<void>> fs;
+    {
+        TRACE_SPAN("spawn");
+        for (uint t = 1; t < std::min<size_t>(th, cnt); t++)
+            fs.push_back(std::async(std::launch::async, worker));
+    }
+    worker();
+    TRACE_SPAN("wait");
+    for (auto & f: fs)
+        f.wait();
+}
 
 AbstractSort::AbstractSort(std::string name) : mName(name) {}
 
 AbstractSort::~AbstractSort() {}
 
-void AbstractSort::SetArray(std::vector<int> newArr) {
-    mArray = newArr;
+void AbstractSort::SetArray(const std::vector<int>& newArr) {
+    mArray.assign(newArr.begin(), newArr.end());
+}
+
+void AbstractSort::SetArray(IntArray&& newArr) {
+    mArray = std::move(newArr);
+}
+
+void AbstractSort::SetArray(const int* data, size_t n) {
+    mArray.assign(data, data + n);
+}
+
+void AbstractSort::Reserve(size_t n) {
+    if (mArray.capacity() >= n)
+        return;
+    IntArray().swap(mArray);
+    mArray.reserve(n);
 }
 
-const std::vector<int>& AbstractSort::GetArray() const {
+const IntArray& AbstractSort::GetArray() const {
     return mArray;
 }
 
@@ -34,15 +150,33 @@ void AbstractSort::AddWorstCaseTime(size_t t) {
     mTempStats.mWorstCaseTime = t;
 }
 
+void AbstractSort::AddCpuInfo(int core, long mhz, int turbo) {
+    mTempStats.mCore = core;
+    mTempStats.mFreqMHz = mhz;
+    mTempStats.mTurbo = turbo;
+}
+
+void AbstractSort::AddMemoryUsage(const AllocUsage& usage) {
+    mTempStats.mAllocCount = std::max(mTempStats.mAllocCount, usage.mCount);
+    mTempStats.mAllocBytes = std::max(mTempStats.mAllocBytes, usage.mBytes);
+    mTempStats.mPeakRssKb = std::max(mTempStats.mPeakRssKb, usage.mPeakRssKb);
+}
+
+void AbstractSort::ReserveStats(size_t points) {
+    mHist.Reserve(points);
+}
+
 void AbstractSort::PushStats(size_t n) {
     mTempStats.mNumOfElements = n;
     mTempStats.mMidCaseTime = GetMidMidCase();
 
-    mHist.Add(new StatsEntry(mTempStats));
+    mHist.Add(mTempStats);
     mMidCaseTmp.clear();
+    mTempStats.mAllocCount = mTempStats.mAllocBytes = 0;
+    mTempStats.mPeakRssKb = -1;
 }
 
-std::string AbstractSort::GetName() const {
+const std::string& AbstractSort::GetName() const {
     return mName;
 }
 
@@ -50,6 +184,18 @@ const AlgStats& AbstractSort::GetStats() const {
     return mHist;
 }
 
+void AbstractSort::AddBytesPerElement(double b) {
+    mTempStats.mBytesPerElement = b;
+}
+
+double AbstractSort::BytesPerElement(size_t n) const {
+    return n > 1 ? 2 * sizeof(int) * std::ceil(std::log2(n)) : 0;
+}
+
+uint AbstractSort::GetThreads() const {
+    return 1;
+}
+
 size_t AbstractSort::GetMidMidCase() {
     std::sort(mMidCaseTmp.begin(), mMidCaseTmp.end());
     return mMidCaseTmp[mMidCaseTmp.size()/2];
@@ -61,7 +207,11 @@ void MergeSort::Sort() {
     MergeSortRec(mArray, 0, mArray.size() - 1);
 }
 
-void MergeSort::Merge(std::vector<int>& arr, int l, int m, int r) {
+double MergeSort::BytesPerElement(size_t n) const {
+    return 2 * AbstractSort::BytesPerElement(n);
+}
+
+void MergeSort::Merge(IntArray& arr, int l, int m, int r) {
     uint i, j, k; 
     uint n1 = m - l + 1; 
     uint n2 =  r - m;
@@ -99,7 +249,7 @@ void MergeSort::Merge(std::vector<int>& arr, int l, int m, int r) {
     } 
 }
 
-void MergeSort::MergeSortRec(std::vector<int>& arr, int l, int r) {
+void MergeSort::MergeSortRec(IntArray& arr, int l, int r) {
     if (l < r) { 
         int m = l+(r-l)/2;  
         // Sort first and second halves 
@@ -118,19 +268,25 @@ void MtMergeSort::Sort() {
     MtMergeSortRec(mArray, 0, mArray.size()-1);
 }
 
-void MtMergeSort::MtMerge(std::vector<int>& arr, int l, int m, int r) {
+double MtMergeSort::BytesPerElement(size_t n) const {
+    return 2 * AbstractSort::BytesPerElement(n);
+}
+
+uint MtMergeSort::GetThreads() const {
+    return mMaxThreads;
+}
+
+void MtMergeSort::MtMerge(IntArray& arr, int l, int m, int r) {
     uint i, j, k; 
     uint n1 = m - l + 1; 
     uint n2 =  r - m;
   
-    // new tmp vectors
-    std::vector<int> L,R;
+    // both halves go to the scratch arena of the merging thread
+    int* L = Memory::Scratch(n1 + n2);
+    int* R = L + n1;
   
     // copy data
-    for (i = 0; i < n1; i++) 
-        L.push_back(arr[l + i]); 
-    for (j = 0; j < n2; j++) 
-        R.push_back(arr[m + 1+ j]); 
+    std::copy(arr.begin() + l, arr.begin() + r + 1, L);
   
     // merge
     i = 0; j = 0; k = l;
@@ -156,35 +312,54 @@ void MtMergeSort::MtMerge(std::vector<int>& arr, int l, int m, int r) {
     } 
 }
 
-void MtMergeSort::MtMergeSortRec(std::vector<int>& arr, int l, int r) {
+void MtMergeSort::MtMergeSortRec(IntArray& arr, int l, int r) {
     thread_cnt++;
     if (l < r) { 
         int m = l+(r-l)/2;  
         // Sort first and second halves 
         if (thread_cnt >= mMaxThreads) {
+            TRACE_LEAF("base-case");
             MtMergeSortRec(arr, l, m); 
             MtMergeSortRec(arr, m+1, r); 
         } else {
-            std::future<void> f = std::async(&MtMergeSort::MtMergeSortRec,
-                                             this, std::ref(arr), l, m);
+            std::future<void> f;
+            {
+                TRACE_SPAN("spawn");
+                f = std::async(&MtMergeSort::MtMergeSortRec,
+                               this, std::ref(arr), l, m);
+            }
             MtMergeSortRec(arr, m+1, r); 
+            TRACE_SPAN("wait");
             f.wait();
         }
+        TRACE_SPAN("merge");
         MtMerge(arr, l, m, r); 
     } 
     thread_cnt--;
 }
 
-QuickSort::QuickSort(int pt) :
-    AbstractSort("Quick Sort (pivotType "+ std::to_string(pt)+ ")"),
-    mPivotType(pt) {}
+QuickSort::QuickSort(int pt, PartitionScheme ps) :
+    AbstractSort("Quick Sort (pivotType "+ std::to_string(pt)+ SchemeName(ps) + ")"),
+    mPivotType(pt), mScheme(ps) {}
 
 void QuickSort::Sort() {
     QuickSortRec(mArray, 0, mArray.size() - 1);
 }
 
-int QuickSort::Partition(std::vector<int>& arr, int l, int h) {
-    int pivot = GetPivot(arr, l, h);    // pivot value
+std::string QuickSort::SchemeName(PartitionScheme ps) {
+    switch (ps) {
+        case PartitionScheme::ThreeWay:
+            return ", three-way";
+        case PartitionScheme::DualPivot:
+            return ", dual-pivot";
+        default:
+            return "";
+    }
+}
+
+int QuickSort::Partition(IntArray& arr, int l, int h) {
+    iter_swap(arr.begin() + GetPivot(arr, l, h), arr.begin() + h);
+    int pivot = arr[h];    // pivot value
     int i = (l - 1);  // Index of smaller element 
   
     for (int j = l; j <= h- 1; j++) { 
@@ -193,53 +368,122 @@ int QuickSort::Partition(std::vector<int>& arr, int l, int h) {
         if (arr[j] <= pivot) { 
             i++;    // increment index of smaller element 
             iter_swap(arr.begin() + i, arr.begin() + j);
-            // arr.swap()swap(&arr[i], &arr[j]); 
         } 
     } 
     iter_swap(arr.begin() + i + 1, arr.begin() + h);
     return (i + 1); 
 }
 
-int QuickSort::GetPivot(std::vector<int>& arr, int l, int h) {
+std::pair<int, int> QuickSort::ThreeWayPartition(IntArray& arr, int l, int h) {
+    int pivot = arr[h];
+    int lt = l, i = l, gt = h;
+    // [l, lt) < pivot, [lt, i) == pivot, (gt, h] > pivot
+    while (i <= gt) {
+        if (arr[i] < pivot)
+            iter_swap(arr.begin() + lt++, arr.begin() + i++);
+        else if (arr[i] > pivot)
+            iter_swap(arr.begin() + i, arr.begin() + gt--);
+        else
+            i++;
+    }
+    return {lt, gt};
+}
+
+std::pair<int, int> QuickSort::DualPivotPartition(IntArray& arr, int l, int h) {
+    // take the pivots from the tertiles, the ends are bad on presorted input
+    int t = (h - l + 1) / 3;
+    if (t > 0) {
+        iter_swap(arr.begin() + l, arr.begin() + l + t);
+        iter_swap(arr.begin() + h, arr.begin() + h - t);
+    }
+    if (arr[l] > arr[h])
+        iter_swap(arr.begin() + l, arr.begin() + h);
+    int p = arr[l], q = arr[h];
+
+    // [l+1, lt) < p, [lt, k) in [p, q], (gt, h-1] > q
+    int lt = l + 1, gt = h - 1;
+    for (int k = l + 1; k <= gt; k++) {
+        if (arr[k] < p) {
+            iter_swap(arr.begin() + k, arr.begin() + lt++);
+        } else if (arr[k] > q) {
+            while (arr[gt] > q && k < gt)
+                gt--;
+            iter_swap(arr.begin() + k, arr.begin() + gt--);
+            if (arr[k] < p)
+                iter_swap(arr.begin() + k, arr.begin() + lt++);
+        }
+    }
+    lt--;
+    gt++;
+    iter_swap(arr.begin() + l, arr.begin() + lt);
+    iter_swap(arr.begin() + h, arr.begin() + gt);
+    return {lt, gt};
+}
+
+int QuickSort::GetPivot(IntArray& arr, int l, int h) {
     switch (mPivotType) {
-        case 0:
-            return arr[h];
-        case 1:
-            return MidOfThree(arr[l+1], arr[(l + h)/2], arr[h]);
+        case 1: {
+            int m = (l + h)/2;
+            int pivot = MidOfThree(arr[l+1], arr[m], arr[h]);
+            return pivot == arr[h] ? h : (pivot == arr[m] ? m : l+1);
+        }
         default:
-            return arr[h];
+            return h;
     }
 }
 
 int QuickSort::MidOfThree(int a, int b, int c) {
-		if(a<=b && b<=c)
-            return b;
-        if(b<=a && a<=c)
-            return a;
-        if(a<=c && c<=b)
-            return c;
-        return -1;
+    if ((a <= b && b <= c) || (c <= b && b <= a))
+        return b;
+    if ((b <= a && a <= c) || (c <= a && a <= b))
+        return a;
+    return c;
 }
 
-void QuickSort::QuickSortRec(std::vector<int>& arr, int l, int h) {
+void QuickSort::QuickSortRec(IntArray& arr, int l, int h) {
     if (l < h) 
     { 
-        int pi = Partition(arr, l, h); 
-  
-        QuickSortRec(arr, l, pi - 1); 
-        QuickSortRec(arr, pi + 1, h); 
+        switch (mScheme) {
+            case PartitionScheme::ThreeWay: {
+                iter_swap(arr.begin() + GetPivot(arr, l, h), arr.begin() + h);
+                std::pair<int, int> eq = ThreeWayPartition(arr, l, h);
+                QuickSortRec(arr, l, eq.first - 1);
+                QuickSortRec(arr, eq.second + 1, h);
+                break;
+            }
+            case PartitionScheme::DualPivot: {
+                std::pair<int, int> pv = DualPivotPartition(arr, l, h);
+                QuickSortRec(arr, l, pv.first - 1);
+                // equal pivots leave only pivot copies in the middle
+                if (arr[pv.first] != arr[pv.second])
+                    QuickSortRec(arr, pv.first + 1, pv.second - 1);
+                QuickSortRec(arr, pv.second + 1, h);
+                break;
+            }
+            default: {
+                int pi = Partition(arr, l, h); 
+                QuickSortRec(arr, l, pi - 1); 
+                QuickSortRec(arr, pi + 1, h); 
+            }
+        }
     } 
 }
 
-MtQuickSort::MtQuickSort(uint th) :
-    AbstractSort("Quick Sort (mt"+std::to_string(th)+")"), mMaxThreads(th) {}
+MtQuickSort::MtQuickSort(uint th, PartitionScheme ps) :
+    AbstractSort("Quick Sort (mt"+std::to_string(th)+QuickSort::SchemeName(ps)+")"),
+    mMaxThreads(th), mScheme(ps) {}
 
 void MtQuickSort::Sort() {
     MtQuickSortRec(mArray, 0, mArray.size() - 1);
 }
 
-int MtQuickSort::MtPartition(std::vector<int>& arr, int l, int h) {
-    int pivot = MtMidOfThree(arr[l+1],arr[(l + h)/2],arr[h]);    // pivot 
+uint MtQuickSort::GetThreads() const {
+    return mMaxThreads;
+}
+
+int MtQuickSort::MtPartition(IntArray& arr, int l, int h) {
+    MtMoveMidToEnd(arr, l, h);
+    int pivot = arr[h];    // pivot 
     int i = (l - 1);  // Index of smaller element 
   
     for (int j = l; j <= h- 1; j++) { 
@@ -248,35 +492,158 @@ int MtQuickSort::MtPartition(std::vector<int>& arr, int l, int h) {
         if (arr[j] <= pivot) { 
             i++;    // increment index of smaller element 
             iter_swap(arr.begin() + i, arr.begin() + j);
-            // arr.swap()swap(&arr[i], &arr[j]); 
         } 
     } 
     iter_swap(arr.begin() + i + 1, arr.begin() + h);
     return (i + 1); 
 }
 
+int MtQuickSort::ParallelPartition(IntArray& arr, int l, int h, uint th) {
+    MtMoveMidToEnd(arr, l, h);
+    const int pivot = arr[h];
+    // blocks of [l, h): left block i at l + i*kBlock, right block i at h - (i+1)*kBlock
+    const int blocks = (h - l) / kBlock;
+    std::atomic<int> remaining(blocks), nextLeft(0), nextRight(0);
+    std::vector<int> openLeft(th, -1), openRight(th, -1);
+
+    RunParallel(th, th, [&](size_t t) {
+        int li = -1, ri = -1, lp = 0, rp = 0;
+        while (true) {
+            if (li < 0) {
+                if (remaining-- <= 0)
+                    break;
+                li = nextLeft++;
+                lp = 0;
+            }
+            if (ri < 0) {
+                if (remaining-- <= 0)
+                    break;
+                ri = nextRight++;
+                rp = 0;
+            }
+            int* lb = &arr[l + li * kBlock];
+            int* rb = &arr[h - (ri + 1) * kBlock];
+            while (lp < kBlock && rp < kBlock) {
+                while (lp < kBlock && lb[lp] <= pivot)
+                    lp++;
+                while (rp < kBlock && rb[rp] > pivot)
+                    rp++;
+                if (lp < kBlock && rp < kBlock)
+                    std::swap(lb[lp++], rb[rp++]);
+            }
+            if (lp == kBlock)
+                li = -1;
+            if (rp == kBlock)
+                ri = -1;
+        }
+        openLeft[t] = li;
+        openRight[t] = ri;
+    });
+
+    // move the unfinished blocks next to the gap between the block areas
+    int lblocks = nextLeft, rblocks = nextRight;
+    auto gather = [&](std::vector<int>& open, int claimed, bool left) {
+        auto pos = [&](int i) {
+            return arr.begin() + (left ? l + i * kBlock : h - (i + 1) * kBlock);
+        };
+        open.erase(std::remove(open.begin(), open.end(), -1), open.end());
+        std::sort(open.begin(), open.end());
+        int inner = claimed - open.size();
+        // unfinished blocks below inner trade places with finished ones above it
+        size_t k = std::lower_bound(open.begin(), open.end(), inner) - open.begin();
+        for (int i = inner, u = 0; i < claimed && u < (int)k; i++) {
+            if (std::binary_search(open.begin(), open.end(), i))
+                continue;
+            std::swap_ranges(pos(open[u]), pos(open[u]) + kBlock, pos(i));
+            u++;
+        }
+        return inner;
+    };
+    int a = l + gather(openLeft, lblocks, true) * kBlock;
+    int b = h - gather(openRight, rblocks, false) * kBlock;
+
+    // [l, a) <= pivot, [b, h) > pivot, the gap is left to partition
+    int i = a;
+    for (int j = a; j < b; j++)
+        if (arr[j] <= pivot)
+            std::swap(arr[i++], arr[j]);
+    std::swap(arr[i], arr[h]);
+    return i;
+}
+
 int MtQuickSort::MtMidOfThree(int a, int b, int c) {
-		if(a<=b && b<=c)
-            return b;
-        if(b<=a && a<=c)
-            return a;
-        if(a<=c && c<=b)
-            return c;
-        return -1;
+    if ((a <= b && b <= c) || (c <= b && b <= a))
+        return b;
+    if ((b <= a && a <= c) || (c <= a && a <= b))
+        return a;
+    return c;
+}
+
+void MtQuickSort::MtMoveMidToEnd(IntArray& arr, int l, int h) {
+    int m = (l + h)/2;
+    int pivot = MtMidOfThree(arr[l+1], arr[m], arr[h]);
+    if (pivot != arr[h])
+        iter_swap(arr.begin() + (pivot == arr[m] ? m : l+1), arr.begin() + h);
 }
 
-void MtQuickSort::MtQuickSortRec(std::vector<int>& arr, int l, int h) {
+void MtQuickSort::MtQuickSortRec(IntArray& arr, int l, int h) {
     thread_cnt++;
     if (l < h) 
     { 
-        int pi = MtPartition(arr, l, h); 
+        // partitions left to sort as [low, high] pairs
+        std::pair<int, int> parts[3];
+        int cnt = 0;
+        {
+            TRACE_SPAN("partition");
+            switch (mScheme) {
+                case PartitionScheme::ThreeWay: {
+                    MtMoveMidToEnd(arr, l, h);
+                    std::pair<int, int> eq = QuickSort::ThreeWayPartition(arr, l, h);
+                    parts[cnt++] = {l, eq.first - 1};
+                    parts[cnt++] = {eq.second + 1, h};
+                    break;
+                }
+                case PartitionScheme::DualPivot: {
+                    std::pair<int, int> pv = QuickSort::DualPivotPartition(arr, l, h);
+                    parts[cnt++] = {l, pv.first - 1};
+                    if (arr[pv.first] != arr[pv.second])
+                        parts[cnt++] = {pv.first + 1, pv.second - 1};
+                    parts[cnt++] = {pv.second + 1, h};
+                    break;
+                }
+                default: {
+                    // the free threads help with the large top level ranges
+                    uint idle = mMaxThreads + 1 - std::min<uint>(thread_cnt, mMaxThreads);
+                    int pi;
+                    if (h - l + 1 >= kParallelMin && idle > 1) {
+                        // the helpers count as running threads, so no
+                        // recursive spawn oversubscribes the cores meanwhile
+                        thread_cnt += idle - 1;
+                        pi = ParallelPartition(arr, l, h, idle);
+                        thread_cnt -= idle - 1;
+                    } else {
+                        pi = MtPartition(arr, l, h);
+                    }
+                    parts[cnt++] = {l, pi - 1};
+                    parts[cnt++] = {pi + 1, h};
+                }
+            }
+        }
 
         if (thread_cnt >= mMaxThreads) {
-            MtQuickSortRec(arr, l, pi - 1);
-            MtQuickSortRec(arr, pi + 1, h);
+            TRACE_LEAF("base-case");
+            for (int i = 0; i < cnt; i++)
+                MtQuickSortRec(arr, parts[i].first, parts[i].second);
         } else {
-            std::future<void> f = std::async(&MtQuickSort::MtQuickSortRec, this, std::ref(arr), l, pi - 1);
-            MtQuickSortRec(arr, pi + 1, h);
+            std::future<void> f;
+            {
+                TRACE_SPAN("spawn");
+                f = std::async(&MtQuickSort::MtQuickSortRec, this, std::ref(arr),
+                               parts[0].first, parts[0].second);
+            }
+            for (int i = 1; i < cnt; i++)
+                MtQuickSortRec(arr, parts[i].first, parts[i].second);
+            TRACE_SPAN("wait");
             f.wait();
         }
     } 
@@ -297,4 +664,582 @@ void InsertSort::Sort() {
         } 
         mArray[j + 1] = key; 
     } 
-}
\ No newline at end of file
+}
+
+double InsertSort::BytesPerElement(size_t n) const {
+    // on average every element is shifted over a quarter of the array
+    return 2 * sizeof(int) * (n / 4.0 + 1);
+}
+
+KWayMergeSort::KWayMergeSort(uint k, size_t chunk) :
+    KWayMergeSort("K-Way Merge Sort", k, chunk) {}
+
+KWayMergeSort::KWayMergeSort(std::string name, uint k, size_t chunk) :
+    AbstractSort(name), mFanIn(k), mChunk(chunk) {
+    if (mChunk == 0) {
+        // half of L2 for the chunk, the rest for the sort's stack and code
+        mChunk = CacheSize(_SC_LEVEL2_CACHE_SIZE, 256 * 1024) / 2 / sizeof(int);
+    }
+    if (mFanIn == 0) {
+        // every input run and the output need one cache line in L1 and one
+        // TLB entry, a typical L1 DTLB has 64 entries so stay at half of it
+        size_t lines = CacheSize(_SC_LEVEL1_DCACHE_SIZE, 32 * 1024)
+                       / CacheSize(_SC_LEVEL1_DCACHE_LINESIZE, 64);
+        mFanIn = std::min<size_t>(32, lines / 4);
+    }
+    mFanIn = std::max<uint>(mFanIn, 2);
+}
+
+void KWayMergeSort::Sort() {
+    size_t n = mArray.size();
+    for (size_t l = 0; l < n; l += mChunk)
+        std::sort(mArray.begin() + l, mArray.begin() + std::min(n, l + mChunk));
+
+    IntArray buf(n);
+    for (size_t run = mChunk; run < n; run *= mFanIn) {
+        for (size_t l = 0; l < n; l += run * mFanIn) {
+            std::vector<size_t> begins, ends;
+            for (size_t b = l; b < std::min(n, l + run * mFanIn); b += run) {
+                begins.push_back(b);
+                ends.push_back(std::min(n, b + run));
+            }
+            MergeRuns(mArray.data(), begins, ends, buf.data() + l);
+        }
+        mArray.swap(buf);
+    }
+}
+
+double KWayMergeSort::BytesPerElement(size_t n) const {
+    return 2 * sizeof(int) * (1 + MergePasses(n));
+}
+
+void KWayMergeSort::MergeRuns(const int* src, const std::vector<size_t>& begins,
+                              const std::vector<size_t>& ends, int* dst) {
+    size_t total = 0;
+    for (size_t i = 0; i < begins.size(); i++)
+        total += ends[i] - begins[i];
+
+    if (begins.size() == 1) {
+        std::copy(src + begins[0], src + ends[0], dst);
+        return;
+    }
+    LoserTree tree(src, begins, ends);
+    for (size_t k = 0; k < total; k++)
+        dst[k] = tree.Pop();
+}
+
+size_t KWayMergeSort::MergePasses(size_t n) const {
+    size_t passes = 0;
+    for (size_t run = mChunk; run < n; run *= mFanIn)
+        passes++;
+    return passes;
+}
+
+MtKWayMergeSort::MtKWayMergeSort(uint th, uint k, size_t chunk) :
+    KWayMergeSort("K-Way Merge Sort (mt"+std::to_string(th)+")", k, chunk),
+    mMaxThreads(std::max<uint>(th, 1)) {}
+
+void MtKWayMergeSort::Sort() {
+    size_t n = mArray.size();
+    ParallelFor((n + mChunk - 1) / mChunk, [&](size_t c) {
+        TRACE_LEAF("base-case");
+        size_t l = c * mChunk;
+        std::sort(mArray.begin() + l, mArray.begin() + std::min(n, l + mChunk));
+    });
+
+    IntArray buf(n);
+    for (size_t run = mChunk; run < n; run *= mFanIn) {
+        size_t groups = (n + run * mFanIn - 1) / (run * mFanIn);
+        size_t slices = std::max<size_t>(1, mMaxThreads / groups);
+        const int* src = mArray.data();
+        int* dst = buf.data();
+
+        ParallelFor(groups * slices, [&](size_t task) {
+            size_t l = (task / slices) * run * mFanIn;
+            size_t r = std::min(n, l + run * mFanIn);
+            size_t slice = task % slices;
+
+            std::vector<size_t> begins, ends;
+            for (size_t b = l; b < r; b += run) {
+                begins.push_back(b);
+                ends.push_back(std::min(r, b + run));
+            }
+
+            if (slices > 1) {
+                // slice s takes the values in [split[s], split[s+1]) of every run
+                std::vector<int> sample;
+                for (size_t i = 0; i < begins.size(); i++)
+                    for (size_t s = 1; s < slices; s++)
+                        sample.push_back(src[begins[i] + (ends[i] - begins[i]) * s / slices]);
+                std::sort(sample.begin(), sample.end());
+
+                for (size_t i = 0; i < begins.size(); i++) {
+                    const int* lo = src + begins[i];
+                    const int* hi = src + ends[i];
+                    if (slice + 1 < slices)
+                        ends[i] = std::lower_bound(lo, hi,
+                            sample[sample.size() * (slice + 1) / slices]) - src;
+                    if (slice > 0)
+                        begins[i] = std::lower_bound(lo, hi,
+                            sample[sample.size() * slice / slices]) - src;
+                }
+            }
+
+            TRACE_SPAN("merge");
+            // everything smaller than this slice lands before it
+            size_t out = l;
+            for (size_t b = l, i = 0; b < r; b += run, i++)
+                out += begins[i] - b;
+            MergeRuns(src, begins, ends, dst + out);
+        });
+        mArray.swap(buf);
+    }
+}
+
+uint MtKWayMergeSort::GetThreads() const {
+    return mMaxThreads;
+}
+
+void MtKWayMergeSort::ParallelFor(size_t cnt,
+                                  const std::function<void(size_t)>& fn) {
+    RunParallel(mMaxThreads, cnt, fn);
+}
+
+RangeSort::RangeSort(uint th, double c) :
+    AbstractSort("Range Sort (mt"+std::to_string(th)+")"),
+    mMaxThreads(std::max<uint>(th, 1)), mRangeFactor(c) {}
+
+void RangeSort::Sort() {
+    if (mArray.size() < 2)
+        return;
+    int mn, mx;
+    size_t distinct = PreScan(mn, mx);
+    size_t n = mArray.size();
+
+    if ((double)mx - mn + 1 <= mRangeFactor * n) {
+        mStrategy = Strategy::Counting;
+        CountingSort(mn, mx);
+    } else {
+        // ~1024 elements per bucket keeps it in L1, but never
+        // more buckets than distinct keys
+        mStrategy = Strategy::Bucket;
+        BucketSort(std::max<size_t>(1, std::min({n / 1024, distinct, (size_t)4096})));
+    }
+}
+
+double RangeSort::BytesPerElement(size_t n) const {
+    (void)n;
+    return mStrategy == Strategy::Counting ? 3 * sizeof(int) : 6 * sizeof(int);
+}
+
+uint RangeSort::GetThreads() const {
+    return mMaxThreads;
+}
+
+RangeSort::Strategy RangeSort::GetStrategy() const {
+    return mStrategy;
+}
+
+size_t RangeSort::PreScan(int& mn, int& mx) {
+    const size_t bits = 1 << 14;
+    size_t n = mArray.size();
+    std::vector<int> mins(mMaxThreads, mArray[0]), maxs(mMaxThreads, mArray[0]);
+    std::vector<std::vector<bool>> maps(mMaxThreads, std::vector<bool>(bits));
+
+    RunParallel(mMaxThreads, mMaxThreads, [&](size_t t) {
+        int lo = mArray[0], hi = mArray[0];
+        std::vector<bool>& map = maps[t];
+        for (size_t i = n * t / mMaxThreads; i < n * (t + 1) / mMaxThreads; i++) {
+            int v = mArray[i];
+            lo = std::min(lo, v);
+            hi = std::max(hi, v);
+            map[((uint32_t)v * 2654435761u) >> 18] = true;
+        }
+        mins[t] = lo;
+        maxs[t] = hi;
+    });
+    mn = *std::min_element(mins.begin(), mins.end());
+    mx = *std::max_element(maxs.begin(), maxs.end());
+
+    size_t zeros = 0;
+    for (size_t b = 0; b < bits; b++) {
+        bool set = false;
+        for (auto const & map: maps)
+            set = set || map[b];
+        zeros += !set;
+    }
+    if (zeros == 0)
+        return n;
+    return std::min<size_t>(n, bits * std::log((double)bits / zeros) + 1);
+}
+
+void RangeSort::CountingSort(int mn, int mx) {
+    size_t n = mArray.size();
+    size_t range = (size_t)((long long)mx - mn) + 1;
+    // every thread needs a histogram of the whole range, keep their
+    // total size within a few times the array
+    uint th = std::min<size_t>({mMaxThreads, std::max<size_t>(1, n / 65536),
+                                std::max<size_t>(1, 4 * n / range)});
+
+    // per thread histograms of the slices
+    std::vector<std::vector<uint32_t>> counts(th, std::vector<uint32_t>(range));
+    RunParallel(th, th, [&](size_t t) {
+        std::vector<uint32_t>& cnt = counts[t];
+        for (size_t i = n * t / th; i < n * (t + 1) / th; i++)
+            cnt[mArray[i] - mn]++;
+    });
+    for (uint t = 1; t < th; t++)
+        for (size_t k = 0; k < range; k++)
+            counts[0][k] += counts[t][k];
+
+    // prefix sums give the first position of every key
+    std::vector<size_t> offsets(range + 1, 0);
+    for (size_t k = 0; k < range; k++)
+        offsets[k + 1] = offsets[k] + counts[0][k];
+
+    RunParallel(th, th, [&](size_t t) {
+        for (size_t k = range * t / th; k < range * (t + 1) / th; k++)
+            std::fill(mArray.begin() + offsets[k], mArray.begin() + offsets[k + 1],
+                      (int)(mn + (long long)k));
+    });
+}
+
+void RangeSort::BucketSort(size_t buckets) {
+    size_t n = mArray.size();
+    uint th = mMaxThreads;
+
+    // splitters from the quantiles of a sample
+    std::vector<int> sample;
+    size_t step = std::max<size_t>(1, n / (buckets * 16));
+    for (size_t i = step / 2; i < n; i += step)
+        sample.push_back(mArray[i]);
+    std::sort(sample.begin(), sample.end());
+    std::vector<int> splitters;
+    for (size_t b = 1; b < buckets; b++)
+        splitters.push_back(sample[sample.size() * b / buckets]);
+
+    auto bucketOf = [&](int v) {
+        return std::upper_bound(splitters.begin(), splitters.end(), v) - splitters.begin();
+    };
+
+    std::vector<std::vector<size_t>> counts(th, std::vector<size_t>(buckets));
+    RunParallel(th, th, [&](size_t t) {
+        for (size_t i = n * t / th; i < n * (t + 1) / th; i++)
+            counts[t][bucketOf(mArray[i])]++;
+    });
+
+    // every thread scatters its slice to its own part of every bucket
+    std::vector<size_t> bounds(buckets + 1, 0);
+    size_t pos = 0;
+    for (size_t b = 0; b < buckets; b++) {
+        bounds[b] = pos;
+        for (uint t = 0; t < th; t++) {
+            size_t c = counts[t][b];
+            counts[t][b] = pos;
+            pos += c;
+        }
+    }
+    bounds[buckets] = n;
+
+    IntArray buf(n);
+    RunParallel(th, th, [&](size_t t) {
+        std::vector<size_t>& out = counts[t];
+        for (size_t i = n * t / th; i < n * (t + 1) / th; i++)
+            buf[out[bucketOf(mArray[i])]++] = mArray[i];
+    });
+
+    RunParallel(th, buckets, [&](size_t b) {
+        std::sort(buf.begin() + bounds[b], buf.begin() + bounds[b + 1]);
+    });
+    mArray.swap(buf);
+}
+
+/**
+ * @brief Scheme names used in the tuned profiles.
+ * 
+ */
+static const char* kSchemeKeys[] = {"lomuto", "threeway", "dualpivot"};
+
+std::string TuningParams::ToString() const {
+    std::ostringstream out;
+    out << "max_length=" << mMaxLength << " insertion_cutoff=" << mInsertionCutoff
+        << " spawn_grain=" << mSpawnGrain << " radix_bits=" << mRadixBits
+        << " scheme=" << kSchemeKeys[(int)mScheme] << " threads=" << mThreads;
+    return out.str();
+}
+
+/**
+ * @brief Parses a decimal field of a profile line.
+ * 
+ * @param value - text of the field
+ * @param out - parsed value
+ * @return true - the field is a number
+ * @return false - the field is empty, not a number or too large
+ */
+static bool ParseNumber(const std::string& value, size_t& out) {
+    if (value.empty() || value.size() > 19 ||
+        value.find_first_not_of("0123456789") != std::string::npos)
+        return false;
+    out = std::stoull(value);
+    return true;
+}
+
+bool TuningParams::Parse(const std::string& line, TuningParams& p) {
+    p = TuningParams();
+    bool valid = true;
+    std::istringstream in(line);
+    for (std::string kv; in >> kv;) {
+        size_t eq = kv.find('='), v = 0;
+        std::string key = kv.substr(0, eq), value = eq == std::string::npos ? "" : kv.substr(eq + 1);
+        if (key == "scheme") {
+            int ps = 0;
+            while (ps < 3 && value != kSchemeKeys[ps])
+                ps++;
+            valid = valid && ps < 3;
+            if (ps < 3)
+                p.mScheme = (PartitionScheme)ps;
+            continue;
+        }
+        if (!ParseNumber(value, v)) {
+            valid = false;
+            continue;
+        }
+        // out of range values are clamped to the nearest usable one
+        if (key == "max_length")
+            p.mMaxLength = v;
+        else if (key == "insertion_cutoff")
+            p.mInsertionCutoff = std::min<size_t>(std::max<size_t>(v, 1), 1 << 10);
+        else if (key == "spawn_grain")
+            p.mSpawnGrain = std::max<size_t>(v, 1);
+        else if (key == "radix_bits")
+            p.mRadixBits = std::min<size_t>(v, 16);
+        else if (key == "threads")
+            p.mThreads = std::min<size_t>(std::max<size_t>(v, 1), 1 << 10);
+        else
+            valid = false;
+    }
+    if (!valid) {
+        // the size class is kept, its parameters fall back to the defaults
+        size_t maxLength = p.mMaxLength;
+        p = TuningParams();
+        p.mMaxLength = maxLength;
+    }
+    return valid;
+}
+
+const TuningParams& TuningProfile::For(size_t n) const {
+    for (auto const & p: mClasses)
+        if (n <= p.mMaxLength)
+            return p;
+    return mClasses.back();
+}
+
+bool TuningProfile::Load(const std::string& path) {
+    std::ifstream in(path);
+    mClasses.clear();
+    for (std::string line; std::getline(in, line);) {
+        if (line.empty() || line[0] == '#')
+            continue;
+        TuningParams p;
+        if (!TuningParams::Parse(line, p))
+            std::cerr << "Invalid profile line \"" << line << "\" in " << path
+                      << ", using the default parameters" << std::endl;
+        mClasses.push_back(p);
+    }
+    std::sort(mClasses.begin(), mClasses.end(),
+              [](const TuningParams& a, const TuningParams& b) {
+                  return a.mMaxLength < b.mMaxLength;
+              });
+    return !mClasses.empty();
+}
+
+bool TuningProfile::Save(const std::string& path) const {
+    std::ofstream out(path);
+    out << "# AutoSort profile, one size class per line" << std::endl;
+    for (auto const & p: mClasses)
+        out << p.ToString() << std::endl;
+    return out.good();
+}
+
+const std::string AutoSort::kProfilePath = "output-data/autosort.profile";
+
+AutoSort::AutoSort(const std::string& path) : AbstractSort("Auto Sort") {
+    if (!mProfile.Load(path)) {
+        std::cerr << "No tuned profile in " << path << ", using defaults" << std::endl;
+        mProfile.mClasses.push_back(TuningParams());
+    }
+}
+
+AutoSort::AutoSort(const TuningProfile& profile, std::string name) :
+    AbstractSort(name), mProfile(profile) {
+    if (mProfile.mClasses.empty())
+        mProfile.mClasses.push_back(TuningParams());
+}
+
+void AutoSort::Sort() {
+    if (mArray.size() < 2)
+        return;
+    int order = Probe();
+    if (order < 0)
+        std::reverse(mArray.begin(), mArray.end());
+    if (order != 0)
+        return;
+
+    const TuningParams& p = mProfile.For(mArray.size());
+    if (p.mRadixBits) {
+        RadixSort(p);
+        return;
+    }
+    mActiveThreads = 1;
+    int h = mArray.size() - 1;
+    QuickSortRec(p, 0, h, 2 * std::log2(mArray.size()) + 1);
+}
+
+uint AutoSort::GetThreads() const {
+    uint th = 1;
+    for (auto const & p: mProfile.mClasses)
+        th = std::max(th, p.mThreads);
+    return th;
+}
+
+int AutoSort::Probe() const {
+    const size_t samples = 32;
+    size_t n = mArray.size();
+    size_t step = std::max<size_t>(1, (n - 1) / samples);
+    size_t asc = 0, desc = 0;
+    for (size_t i = 0; i + 1 < n; i += step) {
+        asc += mArray[i] <= mArray[i + 1];
+        desc += mArray[i] >= mArray[i + 1];
+    }
+    // a single out of order sample rules the check out, so random
+    // inputs never pay for the full scan
+    size_t total = (n - 2) / step + 1;
+    if (asc == total && std::is_sorted(mArray.begin(), mArray.end()))
+        return 1;
+    if (desc == total && std::is_sorted(mArray.rbegin(), mArray.rend()))
+        return -1;
+    return 0;
+}
+
+void AutoSort::QuickSortRec(const TuningParams& p, int l, int h, int depth) {
+    if (h - l + 1 <= (int)p.mInsertionCutoff) {
+        for (int i = l + 1; i <= h; i++) {
+            int key = mArray[i], j = i - 1;
+            for (; j >= l && mArray[j] > key; j--)
+                mArray[j + 1] = mArray[j];
+            mArray[j + 1] = key;
+        }
+        return;
+    }
+    if (depth == 0) {
+        std::make_heap(mArray.begin() + l, mArray.begin() + h + 1);
+        std::sort_heap(mArray.begin() + l, mArray.begin() + h + 1);
+        return;
+    }
+
+    std::pair<int, int> parts[3];
+    int cnt = 2;
+    if (p.mScheme == PartitionScheme::DualPivot) {
+        std::pair<int, int> pv = QuickSort::DualPivotPartition(mArray, l, h);
+        parts[0] = {l, pv.first - 1};
+        parts[1] = {pv.second + 1, h};
+        // equal pivots leave only pivot copies in the middle
+        if (mArray[pv.first] != mArray[pv.second])
+            parts[cnt++] = {pv.first + 1, pv.second - 1};
+    } else {
+        // median of three to the end
+        int m = l + (h - l) / 2;
+        if (mArray[m] < mArray[l])
+            std::swap(mArray[m], mArray[l]);
+        if (mArray[h] < mArray[l])
+            std::swap(mArray[h], mArray[l]);
+        if (mArray[h] < mArray[m])
+            std::swap(mArray[h], mArray[m]);
+        std::swap(mArray[m], mArray[h]);
+
+        if (p.mScheme == PartitionScheme::ThreeWay) {
+            std::pair<int, int> eq = QuickSort::ThreeWayPartition(mArray, l, h);
+            parts[0] = {l, eq.first - 1};
+            parts[1] = {eq.second + 1, h};
+        } else {
+            int pivot = mArray[h], i = l - 1;
+            for (int j = l; j < h; j++)
+                if (mArray[j] <= pivot)
+                    std::swap(mArray[++i], mArray[j]);
+            std::swap(mArray[i + 1], mArray[h]);
+            parts[0] = {l, i};
+            parts[1] = {i + 2, h};
+        }
+    }
+
+    std::vector<std::future<void>> fs;
+    for (int k = 0; k < cnt; k++) {
+        int pl = parts[k].first, ph = parts[k].second;
+        // claim a thread only for large enough ranges, the last one stays here
+        uint active = mActiveThreads;
+        bool spawn = k + 1 < cnt && (size_t)(ph - pl + 1) >= p.mSpawnGrain &&
+                     active < p.mThreads &&
+                     mActiveThreads.compare_exchange_strong(active, active + 1);
+        if (!spawn) {
+            QuickSortRec(p, pl, ph, depth - 1);
+            continue;
+        }
+        TRACE_SPAN("spawn");
+        fs.push_back(std::async(std::launch::async, [this, &p, pl, ph, depth]() {
+            QuickSortRec(p, pl, ph, depth - 1);
+            mActiveThreads--;
+        }));
+    }
+    TRACE_SPAN("wait");
+    for (auto & f: fs)
+        f.wait();
+}
+
+void AutoSort::RadixSort(const TuningParams& p) {
+    size_t n = mArray.size();
+    const size_t buckets = size_t(1) << p.mRadixBits;
+    const size_t blocks = std::max<uint>(1, std::min<size_t>(p.mThreads, n / p.mSpawnGrain + 1));
+    const size_t blockLen = (n + blocks - 1) / blocks;
+    IntArray buf(n);
+    std::vector<size_t> cnt(blocks * buckets);
+    int* src = mArray.data();
+    int* dst = buf.data();
+
+    for (uint shift = 0; shift < 32; shift += p.mRadixBits) {
+        // flipping the sign bit orders the negative keys first
+        auto digit = [shift, buckets](int v) {
+            return (((uint32_t)v ^ 0x80000000u) >> shift) & (buckets - 1);
+        };
+        std::fill(cnt.begin(), cnt.end(), 0);
+        RunParallel(blocks, blocks, [&](size_t b) {
+            size_t* c = &cnt[b * buckets];
+            for (size_t i = b * blockLen; i < std::min(n, (b + 1) * blockLen); i++)
+                c[digit(src[i])]++;
+        });
+
+        // bucket major, block minor offsets keep the scatter stable
+        size_t sum = 0;
+        bool skip = false;
+        for (size_t d = 0; d < buckets; d++) {
+            size_t start = sum;
+            for (size_t b = 0; b < blocks; b++) {
+                size_t c = cnt[b * buckets + d];
+                cnt[b * buckets + d] = sum;
+                sum += c;
+            }
+            skip |= sum - start == n;
+        }
+        // all keys share the digit, the pass would only copy
+        if (skip)
+            continue;
+
+        RunParallel(blocks, blocks, [&](size_t b) {
+            size_t* c = &cnt[b * buckets];
+            for (size_t i = b * blockLen; i < std::min(n, (b + 1) * blockLen); i++)
+                dst[c[digit(src[i])]++] = src[i];
+        });
+        std::swap(src, dst);
+    }
+    if (src != mArray.data())
+        mArray.swap(buf);
+}
@@ -6,9 +6,14 @@
 #include <string>
 #include <algorithm>
 #include <future>
+#include <atomic>
+#include <functional>
 #include <cassert>
+#include <cstdint>
 
 #include "AlgStats.hpp"
+#include "AllocCounter.hpp"
+#include "Memory.hpp"
 
 /**
  * @brief Abstract function for sorting algorithms supported by our Testing Framework.
@@ -31,17 +36,41 @@ public:
 
     /**
      * @brief Set the mArray vector
+     * The elements are copied into the already allocated mArray storage.
      * 
      * @param newArr - new array (vector) to be sorted
      */
-    void SetArray(std::vector<int> newArr);
+    void SetArray(const std::vector<int>& newArr);
+
+    /**
+     * @brief Set the mArray vector, taking over the storage of newArr
+     * 
+     * @param newArr - new array (vector) to be sorted
+     */
+    void SetArray(IntArray&& newArr);
+
+    /**
+     * @brief Set the mArray vector from a plain buffer
+     * The elements are copied into the already allocated mArray storage.
+     * 
+     * @param data - first element of the new array
+     * @param n - number of elements
+     */
+    void SetArray(const int* data, size_t n);
+
+    /**
+     * @brief Preallocates mArray for n elements with the current memory policy.
+     * 
+     * @param n - number of elements
+     */
+    void Reserve(size_t n);
 
     /**
      * @brief Get a reference to mArray vector
      * 
-     * @return const std::vector<int>& 
+     * @return const IntArray& 
      */
-    const std::vector<int>& GetArray() const;
+    const IntArray& GetArray() const;
 
     /**
      * @brief Checks if the mArray vector is sorted
@@ -78,6 +107,30 @@ public:
      */
     void AddWorstCaseTime(size_t t);
 
+    /**
+     * @brief Adds the cpu state of an isolated run to the current iteration stats.
+     * 
+     * @param core - core the run was pinned to
+     * @param mhz - core frequency after the run, -1 if unknown
+     * @param turbo - 1 turbo enabled, 0 disabled, -1 unknown
+     */
+    void AddCpuInfo(int core, long mhz, int turbo);
+
+    /**
+     * @brief Adds the memory used by a middle case sort to the current
+     * iteration stats, the largest usage of the iteration is kept.
+     * 
+     * @param usage - allocations and peak RSS growth of one sort
+     */
+    void AddMemoryUsage(const AllocUsage& usage);
+
+    /**
+     * @brief Reserves the history for the planned number of iterations.
+     * 
+     * @param points - number of iterations
+     */
+    void ReserveStats(size_t points);
+
     /**
      * @brief Ends the current iteration of sorting.
      * Saves the current iteration stats to history and resets the stats.
@@ -89,9 +142,9 @@ public:
     /**
      * @brief Get the mName value
      * 
-     * @return std::string - printable name of the sorting algorithm
+     * @return const std::string& - printable name of the sorting algorithm
      */
-    std::string GetName() const;
+    const std::string& GetName() const;
 
     /**
      * @brief Get a reference to the mHist object
@@ -100,6 +153,30 @@ public:
      */
     const AlgStats& GetStats() const;
 
+    /**
+     * @brief Adds the bytes moved per element to the current iteration stats.
+     * 
+     * @param b - bytes moved through memory per sorted element
+     */
+    void AddBytesPerElement(double b);
+
+    /**
+     * @brief Estimates the bytes moved through memory per element.
+     * Default model assumes one read and one write of every element
+     * on each of the log2(n) levels of a comparison sort.
+     * 
+     * @param n - number of elements in the array
+     * @return double - bytes moved per element
+     */
+    virtual double BytesPerElement(size_t n) const;
+
+    /**
+     * @brief Get the number of threads the algorithm sorts with
+     * 
+     * @return uint - number of threads
+     */
+    virtual uint GetThreads() const;
+
     /**
      * @brief Pure virtual function for sorting
      * This function implements the Sorting of the algorithm we want to test.
@@ -115,7 +192,7 @@ private:
     size_t GetMidMidCase();
 
 public:
-    std::vector<int> mArray = {};
+    IntArray mArray = {};
 
 private:
     std::string mName;
@@ -142,6 +219,15 @@ public:
      */
     void Sort();
 
+    /**
+     * @brief Every level copies the partition into temporary vectors
+     * and merges it back, so each element is moved twice per level.
+     * 
+     * @param n - number of elements in the array
+     * @return double - bytes moved per element
+     */
+    double BytesPerElement(size_t n) const;
+
 private:
     /**
      * @brief Merge two sorted partitions into one.
@@ -151,7 +237,7 @@ private:
      * @param m - middle element index of the merged partition
      * @param r - right boundary index of the merged partition
      */
-    void Merge(std::vector<int>& arr, int l, int m, int r);
+    void Merge(IntArray& arr, int l, int m, int r);
 
     /**
      * @brief Recursive call for merge sort.
@@ -160,7 +246,7 @@ private:
      * @param l - left boundary index of a partition being sorted
      * @param r - right boundary index of a partition being sorted
      */
-    void MergeSortRec(std::vector<int>& arr, int l, int r);
+    void MergeSortRec(IntArray& arr, int l, int r);
 };
 
 /**
@@ -182,6 +268,16 @@ public:
      */
     void Sort();
 
+    /**
+     * @brief Same memory traffic as the sequential merge sort.
+     * 
+     * @param n - number of elements in the array
+     * @return double - bytes moved per element
+     */
+    double BytesPerElement(size_t n) const;
+
+    uint GetThreads() const;
+
 private:
     /**
      * @brief Merge two sorted partitions into one.
@@ -191,7 +287,7 @@ private:
      * @param m - middle element index of the merged partition
      * @param r - right boundary index of the merged partition
      */
-    void MtMerge(std::vector<int>& arr, int l, int m, int r);
+    void MtMerge(IntArray& arr, int l, int m, int r);
 
     /**
      * @brief Recursive call for multithread merge sort.
@@ -206,7 +302,7 @@ private:
      * @param l - left boundary index of a partition being sorted
      * @param r - right boundary index of a partition being sorted
      */
-    void MtMergeSortRec(std::vector<int>& arr, int l, int r);
+    void MtMergeSortRec(IntArray& arr, int l, int r);
 
 private:
     uint mMaxThreads;
@@ -218,6 +314,15 @@ private:
     std::atomic<uint> thread_cnt = 0;
 };
 
+/**
+ * @brief Partitioning schemes supported by the quick sort algorithms.
+ * Lomuto: two partitions, elements equal to the pivot go to the left one.
+ * ThreeWay: Dutch national flag, elements equal to the pivot are excluded
+ * from the recursion.
+ * DualPivot: Yaroslavskiy's scheme, three partitions around two pivots.
+ */
+enum class PartitionScheme { Lomuto, ThreeWay, DualPivot };
+
 /**
  * @brief Simple recursive quick sort algorithm implementation.
  * 
@@ -231,8 +336,9 @@ public:
      * middle, and the last element.
      * 
      * @param pt - pivot selection type
+     * @param ps - partitioning scheme
      */
-    QuickSort(int pt);
+    QuickSort(int pt, PartitionScheme ps = PartitionScheme::Lomuto);
 
     /**
      * @brief Implements the quick sort algorithm
@@ -241,6 +347,38 @@ public:
      */
     void Sort();
 
+    /**
+     * @brief Partitions [l, h] into elements smaller than, equal to
+     * and greater than the pivot arr[h].
+     * 
+     * @param arr - vector being sorted
+     * @param l - low element index (left boundary)
+     * @param h - high element index (right boundary), holds the pivot
+     * @return std::pair<int, int> - first and last index of the elements
+     * equal to the pivot
+     */
+    static std::pair<int, int> ThreeWayPartition(IntArray& arr, int l, int h);
+
+    /**
+     * @brief Partitions [l, h] around the pivots arr[l] <= arr[h] into
+     * elements smaller than the first pivot, elements between the pivots
+     * and elements greater than the second pivot.
+     * 
+     * @param arr - vector being sorted
+     * @param l - low element index (left boundary), holds the first pivot
+     * @param h - high element index (right boundary), holds the second pivot
+     * @return std::pair<int, int> - final indices of the two pivots
+     */
+    static std::pair<int, int> DualPivotPartition(IntArray& arr, int l, int h);
+
+    /**
+     * @brief Returns the partitioning scheme name used in the algorithm names.
+     * 
+     * @param ps - partitioning scheme
+     * @return std::string - name suffix, empty for the Lomuto scheme
+     */
+    static std::string SchemeName(PartitionScheme ps);
+
 private:
     /**
      * @brief Selects the pivot and create two partitions around it.
@@ -250,7 +388,7 @@ private:
      * @param h - high element index (right boundary)
      * @return int - pivot index
      */
-    int Partition(std::vector<int>& arr, int l, int h);
+    int Partition(IntArray& arr, int l, int h);
 
     /**
      * @brief Recursive call for quick sort.
@@ -259,7 +397,7 @@ private:
      * @param l - low element index (left boundary)
      * @param h - high element index (right boundary)
      */
-    void QuickSortRec(std::vector<int>& arr, int l, int h);
+    void QuickSortRec(IntArray& arr, int l, int h);
 
     /**
      * @brief Returns the pivot based on the pivot selection type
@@ -267,9 +405,9 @@ private:
      * @param arr - vector being sorted
      * @param l - low element index (left boundary) 
      * @param h - high element index (right boundary)
-     * @return int - pivot value
+     * @return int - pivot index
      */
-    int GetPivot(std::vector<int>& arr, int l, int h);
+    int GetPivot(IntArray& arr, int l, int h);
 
     /**
      * @brief Returns the middle value of the given three values.
@@ -283,6 +421,7 @@ private:
 
 private:
     int mPivotType;
+    PartitionScheme mScheme;
 };
 
 /**
@@ -295,8 +434,9 @@ public:
      * @brief Construct a new MtQuickSort object
      * 
      * @param th - number of available threads
+     * @param ps - partitioning scheme
      */
-    MtQuickSort(uint th);
+    MtQuickSort(uint th, PartitionScheme ps = PartitionScheme::Lomuto);
     
     /**
      * @brief Implements the multithread quick sort algorithm
@@ -304,6 +444,8 @@ public:
      */
     void Sort();
 
+    uint GetThreads() const;
+
 private:
     /**
      * @brief Selects the pivot and create two partitions around it.
@@ -313,21 +455,37 @@ private:
      * @param h - high element index (right boundary)
      * @return int - pivot index
      */
-    int MtPartition(std::vector<int>& arr, int l, int h);
+    int MtPartition(IntArray& arr, int l, int h);
+
+    /**
+     * @brief Partitions [l, h] around the pivot arr[h] on th threads.
+     * The range is cut into blocks claimed from both ends through atomic
+     * cursors. Every thread swaps the misplaced elements of its left and
+     * right block until one of them is neutralized, then claims the next
+     * one. The blocks left unfinished are swapped next to the middle gap
+     * and partitioned sequentially with it.
+     * 
+     * @param arr - vector being sorted
+     * @param l - low element index (left boundary)
+     * @param h - high element index (right boundary), holds the pivot
+     * @param th - number of threads including the calling one
+     * @return int - pivot index
+     */
+    int ParallelPartition(IntArray& arr, int l, int h, uint th);
 
     /**
      * @brief Recursive call for multithread quick sort.
-     * Method calls MtPartition method. If there are no
-     * additional threads available, sort the partitions
-     * in the current thread. If there is an additional
-     * thread available, use it for the first partition
-     * and sort the second one on the current thread.
+     * Method partitions the range with the selected scheme. If there
+     * are no additional threads available, sort the partitions in
+     * the current thread. If there is an additional thread available,
+     * use it for the first partition and sort the rest on the current
+     * thread.
      * 
      * @param arr - vector being sorted
      * @param l - low element index (left boundary)
      * @param h - high element index (right boundary)
      */
-    void MtQuickSortRec(std::vector<int>& arr, int l, int h);
+    void MtQuickSortRec(IntArray& arr, int l, int h);
 
     /**
      * @brief Returns the middle value of the given three values.
@@ -339,8 +497,27 @@ private:
      */
     int MtMidOfThree(int a, int b, int c);
 
+    /**
+     * @brief Moves the middle value of the first, middle and last
+     * element to the last position.
+     * 
+     * @param arr - vector being sorted
+     * @param l - low element index (left boundary)
+     * @param h - high element index (right boundary)
+     */
+    void MtMoveMidToEnd(IntArray& arr, int l, int h);
+
 private:
+    /**
+     * @brief Block length of the parallel partition, and the shortest
+     * range partitioned in parallel.
+     * 
+     */
+    static const int kBlock = 4096;
+    static const int kParallelMin = 1 << 17;
+
     uint mMaxThreads;
+    PartitionScheme mScheme;
 
     /**
      * @brief Number of threads currently being used.
@@ -353,6 +530,338 @@ class InsertSort : public AbstractSort {
 public: 
     InsertSort();
     void Sort();
+    double BytesPerElement(size_t n) const;
+};
+
+/**
+ * @brief Cache-aware multiway merge sort algorithm implementation.
+ * The array is cut into chunks that fit into the L2 cache, every chunk
+ * is sorted in cache, and the sorted runs are merged k at a time with
+ * a loser tree. This needs log_k(n/chunk) passes over the memory
+ * instead of log2(n).
+ * 
+ */
+class KWayMergeSort : public AbstractSort {
+public:
+    /**
+     * @brief Construct a new KWayMergeSort object
+     * 
+     * @param k - merge fan-in, 0 selects it from the cache and TLB size
+     * @param chunk - number of elements sorted in cache, 0 selects it
+     * from the L2 cache size
+     */
+    KWayMergeSort(uint k = 0, size_t chunk = 0);
+
+    /**
+     * @brief Implements the multiway merge sort algorithm
+     * 
+     */
+    void Sort();
+
+    /**
+     * @brief One read and one write per element for the chunk sorting
+     * and for each of the multiway merge passes.
+     * 
+     * @param n - number of elements in the array
+     * @return double - bytes moved per element
+     */
+    double BytesPerElement(size_t n) const;
+
+protected:
+    /**
+     * @brief Construct a new KWayMergeSort object with a custom name.
+     * 
+     * @param name - printable name of the algorithm
+     * @param k - merge fan-in, 0 selects it from the cache and TLB size
+     * @param chunk - number of elements sorted in cache
+     */
+    KWayMergeSort(std::string name, uint k, size_t chunk);
+
+    /**
+     * @brief Merges up to mFanIn sorted runs from src into dst.
+     * 
+     * @param src - source array containing the runs
+     * @param begins - first index of every run in src
+     * @param ends - one past the last index of every run in src
+     * @param dst - destination of the merged elements
+     */
+    void MergeRuns(const int* src, const std::vector<size_t>& begins,
+                   const std::vector<size_t>& ends, int* dst);
+
+    /**
+     * @brief Number of merge passes needed for n elements.
+     * 
+     * @param n - number of elements in the array
+     * @return size_t - number of merge passes
+     */
+    size_t MergePasses(size_t n) const;
+
+protected:
+    uint mFanIn;
+    size_t mChunk;
+};
+
+/**
+ * @brief Multithread cache-aware multiway merge sort algorithm implementation.
+ * Chunks are sorted in parallel and every merge pass is split into
+ * independent tasks. When a pass has fewer run groups than threads,
+ * the groups are cut into value ranges by sampled splitters so all
+ * threads stay busy until the last pass.
+ * 
+ */
+class MtKWayMergeSort : public KWayMergeSort {
+public:
+    /**
+     * @brief Construct a new MtKWayMergeSort object
+     * 
+     * @param th - number of available threads
+     * @param k - merge fan-in, 0 selects it from the cache and TLB size
+     * @param chunk - number of elements sorted in cache, 0 selects it
+     * from the L2 cache size
+     */
+    MtKWayMergeSort(uint th, uint k = 0, size_t chunk = 0);
+
+    /**
+     * @brief Implements the multithread multiway merge sort algorithm
+     * 
+     */
+    void Sort();
+
+    uint GetThreads() const;
+
+private:
+    /**
+     * @brief Runs fn(i) for every i in [0, cnt) on mMaxThreads threads.
+     * 
+     * @param cnt - number of tasks
+     * @param fn - task body
+     */
+    void ParallelFor(size_t cnt, const std::function<void(size_t)>& fn);
+
+private:
+    uint mMaxThreads;
+};
+
+/**
+ * @brief Range-aware sorting algorithm implementation.
+ * A pre-scan finds the minimum, the maximum and an estimate of the number
+ * of distinct keys. Dense keys (range <= c*n) are sorted by a parallel
+ * counting sort, sparse keys by a bucket sort with splitters taken from
+ * the quantiles of a sample, so every bucket gets a similar share.
+ * 
+ */
+class RangeSort : public AbstractSort {
+public:
+    /**
+     * @brief Strategy selected by the last pre-scan.
+     * 
+     */
+    enum class Strategy { Counting, Bucket };
+
+    /**
+     * @brief Construct a new RangeSort object
+     * 
+     * @param th - number of available threads
+     * @param c - counting sort is used while range <= c*n
+     */
+    RangeSort(uint th = 1, double c = 4);
+
+    /**
+     * @brief Implements the range-aware sort
+     * The method runs the pre-scan and dispatches to the selected strategy.
+     */
+    void Sort();
+
+    /**
+     * @brief Counting sort reads the array twice and writes it once,
+     * bucket sort reads it twice, scatters it and sorts the buckets in cache.
+     * 
+     * @param n - number of elements in the array
+     * @return double - bytes moved per element
+     */
+    double BytesPerElement(size_t n) const;
+
+    uint GetThreads() const;
+
+    /**
+     * @brief Get the strategy selected by the last Sort() call
+     * 
+     * @return Strategy - selected strategy
+     */
+    Strategy GetStrategy() const;
+
+private:
+    /**
+     * @brief Finds the minimum, the maximum and estimates the number
+     * of distinct keys by linear counting over a small hash bitmap.
+     * 
+     * @param mn - minimal key
+     * @param mx - maximal key
+     * @return size_t - estimated number of distinct keys
+     */
+    size_t PreScan(int& mn, int& mx);
+
+    /**
+     * @brief Sorts the array by counting the occurrences of every key.
+     * 
+     * @param mn - minimal key
+     * @param mx - maximal key
+     */
+    void CountingSort(int mn, int mx);
+
+    /**
+     * @brief Sorts the array by scattering it into histogram balanced buckets.
+     * 
+     * @param buckets - number of buckets
+     */
+    void BucketSort(size_t buckets);
+
+private:
+    uint mMaxThreads;
+    double mRangeFactor;
+    Strategy mStrategy = Strategy::Counting;
+};
+
+/**
+ * @brief Tuned parameters of one size class of AutoSort.
+ * 
+ */
+struct TuningParams {
+    size_t mMaxLength = SIZE_MAX;   ///< largest length of the size class
+    uint mInsertionCutoff = 16;     ///< ranges up to this length use insertion sort
+    size_t mSpawnGrain = 1 << 16;   ///< smallest range sorted by a new thread
+    uint mRadixBits = 0;            ///< LSD radix digit width, 0 selects quick sort
+    PartitionScheme mScheme = PartitionScheme::ThreeWay;
+    uint mThreads = 1;
+
+    /**
+     * @brief Returns the parameters as space separated key=value pairs.
+     * 
+     * @return std::string - profile line
+     */
+    std::string ToString() const;
+
+    /**
+     * @brief Parses a profile line, missing keys keep the defaults and out
+     * of range values are clamped. A line with an unknown key, scheme or a
+     * non-numeric value falls back to the defaults, except for its max_length.
+     * 
+     * @param line - space separated key=value pairs
+     * @param p - parsed parameters
+     * @return true - the line is valid
+     * @return false - the line is malformed, p holds the defaults
+     */
+    static bool Parse(const std::string& line, TuningParams& p);
+};
+
+/**
+ * @brief Tuned parameters of all size classes, ordered by their length.
+ * 
+ */
+struct TuningProfile {
+    std::vector<TuningParams> mClasses;
+
+    /**
+     * @brief Returns the parameters of the size class of length n.
+     * 
+     * @param n - number of elements
+     * @return const TuningParams& - parameters of the size class
+     */
+    const TuningParams& For(size_t n) const;
+
+    /**
+     * @brief Reads the profile, one size class per line.
+     * 
+     * @param path - path of the profile
+     * @return true - the profile was read
+     * @return false - the file is missing or holds no size class
+     */
+    bool Load(const std::string& path);
+
+    /**
+     * @brief Writes the profile, one size class per line.
+     * 
+     * @param path - path of the profile
+     * @return true - the profile was written
+     * @return false - the file cannot be written
+     */
+    bool Save(const std::string& path) const;
+};
+
+/**
+ * @brief Hybrid sort driven by a tuned profile.
+ * A cheap probe catches sorted and reversed inputs, otherwise the size
+ * class of the input selects either a parallel LSD radix sort or a
+ * parallel quick sort with the tuned partitioning scheme, spawn grain
+ * and insertion sort cutoff.
+ * 
+ */
+class AutoSort : public AbstractSort {
+public:
+    /**
+     * @brief Path of the profile written by the tuning mode.
+     * 
+     */
+    static const std::string kProfilePath;
+
+    /**
+     * @brief Construct a new AutoSort object from a profile file,
+     * falling back to default parameters when it cannot be read.
+     * 
+     * @param path - path of the profile
+     */
+    AutoSort(const std::string& path = kProfilePath);
+
+    /**
+     * @brief Construct a new AutoSort object
+     * 
+     * @param profile - tuned profile
+     * @param name - algorithm name
+     */
+    AutoSort(const TuningProfile& profile, std::string name = "Auto Sort");
+
+    /**
+     * @brief Implements the dispatch between the tuned algorithms
+     * 
+     */
+    void Sort();
+
+    uint GetThreads() const;
+
+private:
+    /**
+     * @brief Samples adjacent pairs of the array and verifies the
+     * input when they all ascend or all descend.
+     * 
+     * @return int - 1 if sorted, -1 if sorted in descending order, 0 otherwise
+     */
+    int Probe() const;
+
+    /**
+     * @brief Recursive call of the hybrid quick sort.
+     * 
+     * @param p - parameters of the size class
+     * @param l - low element index (left boundary)
+     * @param h - high element index (right boundary)
+     * @param depth - remaining recursion depth before falling back to heap sort
+     */
+    void QuickSortRec(const TuningParams& p, int l, int h, int depth);
+
+    /**
+     * @brief LSD radix sort of the whole array.
+     * 
+     * @param p - parameters of the size class
+     */
+    void RadixSort(const TuningParams& p);
+
+private:
+    TuningProfile mProfile;
+
+    /**
+     * @brief Number of threads currently being used.
+     * 
+     */
+    std::atomic<uint> mActiveThreads = 1;
 };
 
-#endif
\ No newline at end of file
+#endif
@@ -0,0 +1,255 @@
+#include "StringSorting.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <future>
+
+/**
+ * @brief Returns the character of s at position d as an unsigned value.
+ * 
+ */
+static inline unsigned CharAt(const char* s, size_t d) {
+    return (unsigned char)s[d];
+}
+
+/**
+ * @brief Compares s and t from the position depth.
+ * 
+ * @param lcp - receives the length of the common prefix of s and t
+ * @param chars - counter of inspected characters
+ * @return int - negative, zero or positive like strcmp
+ */
+static inline int CompareFrom(const char* s, const char* t, size_t depth,
+                              size_t& lcp, size_t& chars) {
+    size_t d = depth;
+    while (s[d] != '\0' && s[d] == t[d])
+        d++;
+    chars += d - depth + 1;
+    lcp = d;
+    return (int)CharAt(s, d) - (int)CharAt(t, d);
+}
+
+void StringArena::Reserve(size_t strings, size_t chars) {
+    mOffsets.reserve(strings);
+    mChars.reserve(chars);
+}
+
+void StringArena::Add(const std::string& s) {
+    mOffsets.push_back(mChars.size());
+    mChars.insert(mChars.end(), s.begin(), s.end());
+    mChars.push_back('\0');
+}
+
+size_t StringArena::Size() const {
+    return mOffsets.size();
+}
+
+size_t StringArena::Chars() const {
+    return mChars.size();
+}
+
+std::vector<const char*> StringArena::Pointers() const {
+    std::vector<const char*> ptrs(mOffsets.size());
+    for (size_t i = 0; i < mOffsets.size(); i++)
+        ptrs[i] = mChars.data() + mOffsets[i];
+    return ptrs;
+}
+
+AbstractStringSort::AbstractStringSort(std::string name) : mName(name) {}
+
+AbstractStringSort::~AbstractStringSort() {}
+
+void AbstractStringSort::SetStrings(const std::vector<const char*>& strs) {
+    mStrings = strs;
+    mCharsInspected = 0;
+}
+
+const std::vector<const char*>& AbstractStringSort::GetStrings() const {
+    return mStrings;
+}
+
+bool AbstractStringSort::isSorted() const {
+    return std::is_sorted(mStrings.begin(), mStrings.end(),
+        [](const char* a, const char* b) { return strcmp(a, b) < 0; });
+}
+
+size_t AbstractStringSort::GetCharsInspected() const {
+    return mCharsInspected;
+}
+
+const std::string& AbstractStringSort::GetName() const {
+    return mName;
+}
+
+MultikeyQuickSort::MultikeyQuickSort() : AbstractStringSort("Multikey Quick Sort") {}
+
+void MultikeyQuickSort::Sort() {
+    size_t chars = 0;
+    MkqsRec(mStrings.data(), mStrings.size(), 0, chars);
+    mCharsInspected += chars;
+}
+
+void MultikeyQuickSort::MkqsRec(const char** strs, size_t n, size_t depth,
+                                size_t& chars) {
+    if (n < 16) {
+        size_t lcp;
+        for (size_t i = 1; i < n; i++)
+            for (size_t j = i; j > 0 && CompareFrom(strs[j], strs[j-1], depth, lcp, chars) < 0; j--)
+                std::swap(strs[j], strs[j-1]);
+        return;
+    }
+
+    unsigned a = CharAt(strs[0], depth), b = CharAt(strs[n/2], depth),
+             c = CharAt(strs[n-1], depth);
+    unsigned pivot = std::max(std::min(a, b), std::min(std::max(a, b), c));
+    chars += 3;
+
+    // [0, lt) < pivot, [lt, i) == pivot, [gt, n) > pivot
+    size_t lt = 0, i = 0, gt = n;
+    while (i < gt) {
+        unsigned ch = CharAt(strs[i], depth);
+        if (ch < pivot)
+            std::swap(strs[lt++], strs[i++]);
+        else if (ch > pivot)
+            std::swap(strs[i], strs[--gt]);
+        else
+            i++;
+    }
+    chars += n;
+
+    MkqsRec(strs, lt, depth, chars);
+    if (pivot != 0)
+        MkqsRec(strs + lt, gt - lt, depth + 1, chars);
+    MkqsRec(strs + gt, n - gt, depth, chars);
+}
+
+MsdRadixSort::MsdRadixSort() : AbstractStringSort("MSD Radix Sort") {}
+
+void MsdRadixSort::Sort() {
+    size_t n = mStrings.size();
+    std::vector<const char*> tmp(n);
+    std::vector<unsigned char> cache(n);
+    size_t chars = 0;
+    MsdRec(mStrings.data(), tmp.data(), cache.data(), n, 0, chars);
+    mCharsInspected += chars;
+}
+
+void MsdRadixSort::MsdRec(const char** strs, const char** tmp, unsigned char* cache,
+                          size_t n, size_t depth, size_t& chars) {
+    if (n < 64) {
+        MultikeyQuickSort::MkqsRec(strs, n, depth, chars);
+        return;
+    }
+
+    for (size_t i = 0; i < n; i++)
+        cache[i] = strs[i][depth];
+    chars += n;
+
+    size_t cnt[256] = {0};
+    for (size_t i = 0; i < n; i++)
+        cnt[cache[i]]++;
+
+    // a shared character needs no distribution, go straight to the next one
+    if (cnt[cache[0]] == n) {
+        if (cache[0] != 0)
+            MsdRec(strs, tmp, cache, n, depth + 1, chars);
+        return;
+    }
+
+    size_t pos[256];
+    pos[0] = 0;
+    for (int c = 1; c < 256; c++)
+        pos[c] = pos[c-1] + cnt[c-1];
+    for (size_t i = 0; i < n; i++)
+        tmp[pos[cache[i]]++] = strs[i];
+    std::copy(tmp, tmp + n, strs);
+
+    // bucket 0 holds the strings which ended, they are equal
+    size_t start = cnt[0];
+    for (int c = 1; c < 256; c++) {
+        if (cnt[c] > 1)
+            MsdRec(strs + start, tmp, cache, cnt[c], depth + 1, chars);
+        start += cnt[c];
+    }
+}
+
+MtLcpMergeSort::MtLcpMergeSort(uint th) :
+    AbstractStringSort("LCP Merge Sort (mt"+std::to_string(th)+")"),
+    mMaxThreads(th), thread_cnt(0) {}
+
+void MtLcpMergeSort::Sort() {
+    size_t n = mStrings.size();
+    std::vector<const char*> tmp(n);
+    std::vector<size_t> lcp(n), tmpLcp(n);
+    mCharsInspected += LcpMergeSortRec(mStrings.data(), lcp.data(), tmp.data(),
+                                       tmpLcp.data(), n);
+}
+
+size_t MtLcpMergeSort::LcpMergeSortRec(const char** strs, size_t* lcp, const char** tmp,
+                                       size_t* tmpLcp, size_t n) {
+    size_t chars = 0;
+    thread_cnt++;
+    if (n <= 1) {
+        // the merges compute all the lcps, any base case sort
+        // would compare the common prefixes again
+        if (n == 1)
+            lcp[0] = 0;
+    } else {
+        size_t m = n / 2;
+        if (thread_cnt >= mMaxThreads) {
+            chars += LcpMergeSortRec(strs, lcp, tmp, tmpLcp, m);
+            chars += LcpMergeSortRec(strs + m, lcp + m, tmp + m, tmpLcp + m, n - m);
+        } else {
+            std::future<size_t> f = std::async(&MtLcpMergeSort::LcpMergeSortRec, this,
+                                               strs, lcp, tmp, tmpLcp, m);
+            chars += LcpMergeSortRec(strs + m, lcp + m, tmp + m, tmpLcp + m, n - m);
+            chars += f.get();
+        }
+        chars += LcpMerge(strs, lcp, m, strs + m, lcp + m, n - m, tmp, tmpLcp);
+        std::copy(tmp, tmp + n, strs);
+        std::copy(tmpLcp, tmpLcp + n, lcp);
+    }
+    thread_cnt--;
+    return chars;
+}
+
+size_t MtLcpMergeSort::LcpMerge(const char** a, const size_t* la, size_t na,
+                                const char** b, const size_t* lb, size_t nb,
+                                const char** out, size_t* lo) {
+    // ha and hb are the common prefixes of the current candidates with
+    // the last output string, the one with the longer prefix is smaller
+    size_t i = 0, j = 0, k = 0, ha = 0, hb = 0, chars = 0;
+    while (i < na && j < nb) {
+        if (ha > hb) {
+            out[k] = a[i];
+            lo[k++] = ha;
+            ha = ++i < na ? la[i] : 0;
+        } else if (ha < hb) {
+            out[k] = b[j];
+            lo[k++] = hb;
+            hb = ++j < nb ? lb[j] : 0;
+        } else {
+            size_t h;
+            if (CompareFrom(a[i], b[j], ha, h, chars) <= 0) {
+                out[k] = a[i];
+                lo[k++] = ha;
+                hb = h;
+                ha = ++i < na ? la[i] : 0;
+            } else {
+                out[k] = b[j];
+                lo[k++] = hb;
+                ha = h;
+                hb = ++j < nb ? lb[j] : 0;
+            }
+        }
+    }
+    for (; i < na; i++, ha = i < na ? la[i] : 0) {
+        out[k] = a[i];
+        lo[k++] = ha;
+    }
+    for (; j < nb; j++, hb = j < nb ? lb[j] : 0) {
+        out[k] = b[j];
+        lo[k++] = hb;
+    }
+    return chars;
+}
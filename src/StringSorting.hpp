@@ -0,0 +1,244 @@
+#ifndef __jch_StringSorting_hpp__
+#define __jch_StringSorting_hpp__
+
+#include <atomic>
+#include <string>
+#include <vector>
+
+/**
+ * @brief Storage of variable length strings.
+ * All characters live in one contiguous buffer, every string is terminated
+ * by '\0'. Sorting algorithms work on an array of pointers into the arena.
+ * 
+ */
+class StringArena {
+public:
+    /**
+     * @brief Construct a new StringArena object
+     * 
+     */
+    StringArena() {};
+
+    /**
+     * @brief Reserves space for the given amount of strings and characters.
+     * 
+     * @param strings - number of strings
+     * @param chars - number of characters including the terminators
+     */
+    void Reserve(size_t strings, size_t chars);
+
+    /**
+     * @brief Appends a copy of the string to the arena.
+     * 
+     * @param s - string without embedded '\0'
+     */
+    void Add(const std::string& s);
+
+    /**
+     * @brief Get the number of strings in the arena
+     * 
+     * @return size_t - number of strings
+     */
+    size_t Size() const;
+
+    /**
+     * @brief Get the number of characters in the arena including the terminators
+     * 
+     * @return size_t - number of characters
+     */
+    size_t Chars() const;
+
+    /**
+     * @brief Returns pointers to all the strings in insertion order.
+     * The pointers are valid until the next Add() call.
+     * 
+     * @return std::vector<const char*> - pointer array
+     */
+    std::vector<const char*> Pointers() const;
+
+private:
+    std::vector<char> mChars = {};
+    std::vector<size_t> mOffsets = {};
+};
+
+/**
+ * @brief Abstract class for string sorting algorithms.
+ * The algorithms sort an array of pointers to '\0' terminated strings
+ * and count the characters they inspect.
+ * 
+ */
+class AbstractStringSort {
+public:
+    /**
+     * @brief Construct a new AbstractStringSort object
+     * 
+     * @param name - printable name of the algorithm
+     */
+    AbstractStringSort(std::string name);
+
+    /**
+     * @brief Destroy the AbstractStringSort object
+     * 
+     */
+    virtual ~AbstractStringSort() = 0;
+
+    /**
+     * @brief Set the mStrings pointer array and reset the character counter
+     * 
+     * @param strs - pointers to the strings to be sorted
+     */
+    void SetStrings(const std::vector<const char*>& strs);
+
+    /**
+     * @brief Get a reference to mStrings pointer array
+     * 
+     * @return const std::vector<const char*>& 
+     */
+    const std::vector<const char*>& GetStrings() const;
+
+    /**
+     * @brief Checks if the mStrings array is sorted
+     * 
+     * @return true - the array is sorted
+     * @return false - the array is not sorted
+     */
+    bool isSorted() const;
+
+    /**
+     * @brief Get the number of characters inspected since the last SetStrings()
+     * 
+     * @return size_t - number of inspected characters
+     */
+    size_t GetCharsInspected() const;
+
+    /**
+     * @brief Get the mName value
+     * 
+     * @return const std::string& - printable name of the sorting algorithm
+     */
+    const std::string& GetName() const;
+
+    /**
+     * @brief Pure virtual function for sorting
+     * 
+     */
+    virtual void Sort() = 0;
+
+protected:
+    std::vector<const char*> mStrings = {};
+    size_t mCharsInspected = 0;
+
+private:
+    std::string mName;
+};
+
+/**
+ * @brief Multikey quick sort (Bentley-Sedgewick) implementation.
+ * Partitions by one character at a time into smaller, equal and greater
+ * parts, only the equal part advances to the next character.
+ * 
+ */
+class MultikeyQuickSort : public AbstractStringSort {
+public:
+    MultikeyQuickSort();
+    void Sort();
+
+    /**
+     * @brief Sorts strs[0, n) knowing they share the first depth characters.
+     * 
+     * @param strs - strings being sorted
+     * @param n - number of strings
+     * @param depth - length of the common prefix
+     * @param chars - counter of inspected characters
+     */
+    static void MkqsRec(const char** strs, size_t n, size_t depth, size_t& chars);
+};
+
+/**
+ * @brief Most significant digit radix sort implementation.
+ * Every distribution pass first copies the current character of all strings
+ * into a contiguous cache, the only scattered accesses of the pass, and then
+ * counts and distributes from the cache. Small buckets are finished by
+ * the multikey quick sort.
+ * 
+ */
+class MsdRadixSort : public AbstractStringSort {
+public:
+    MsdRadixSort();
+    void Sort();
+
+private:
+    /**
+     * @brief Sorts strs[0, n) knowing they share the first depth characters.
+     * 
+     * @param strs - strings being sorted
+     * @param tmp - temporary pointer array of at least n elements
+     * @param cache - temporary character array of at least n elements
+     * @param n - number of strings
+     * @param depth - length of the common prefix
+     * @param chars - counter of inspected characters
+     */
+    void MsdRec(const char** strs, const char** tmp, unsigned char* cache,
+                size_t n, size_t depth, size_t& chars);
+};
+
+/**
+ * @brief Multithread LCP-aware merge sort implementation.
+ * Every sorted run carries the longest common prefixes of its neighbouring
+ * strings, so merging compares only the characters behind the known
+ * common prefix. The halves are sorted on separate threads while
+ * threads are available.
+ * 
+ */
+class MtLcpMergeSort : public AbstractStringSort {
+public:
+    /**
+     * @brief Construct a new MtLcpMergeSort object
+     * 
+     * @param th - number of available threads
+     */
+    MtLcpMergeSort(uint th);
+    void Sort();
+
+private:
+    /**
+     * @brief Recursive call for the LCP merge sort.
+     * 
+     * @param strs - strings being sorted
+     * @param lcp - lcp[i] receives the common prefix of strs[i-1] and strs[i]
+     * @param tmp - temporary pointer array of at least n elements
+     * @param tmpLcp - temporary lcp array of at least n elements
+     * @param n - number of strings
+     * @return size_t - number of inspected characters
+     */
+    size_t LcpMergeSortRec(const char** strs, size_t* lcp, const char** tmp,
+                           size_t* tmpLcp, size_t n);
+
+    /**
+     * @brief Merges two sorted runs with their lcp arrays.
+     * 
+     * @param a - first run
+     * @param la - lcp array of the first run
+     * @param na - length of the first run
+     * @param b - second run
+     * @param lb - lcp array of the second run
+     * @param nb - length of the second run
+     * @param out - merged run
+     * @param lo - lcp array of the merged run
+     * @return size_t - number of inspected characters
+     */
+    static size_t LcpMerge(const char** a, const size_t* la, size_t na,
+                           const char** b, const size_t* lb, size_t nb,
+                           const char** out, size_t* lo);
+
+private:
+    uint mMaxThreads;
+
+    /**
+     * @brief Number of threads currently being used.
+     * 
+     */
+    std::atomic<uint> thread_cnt;
+};
+
+#endif
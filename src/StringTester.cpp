@@ -0,0 +1,102 @@
+#include "StringTester.hpp"
+#include "TesterFramework.hpp"
+
+void StringTester::AddAlg(std::unique_ptr<AbstractStringSort> alg_ptr) {
+    mAlgs.push_back(std::move(alg_ptr));
+}
+
+void StringTester::StartTests(const std::vector<size_t>& lengths, size_t repeat_test) {
+    for (StringDataset kind: {StringDataset::Random, StringDataset::CommonPrefix,
+                              StringDataset::Url}) {
+        for (size_t n: lengths) {
+            std::cout << "Testing " << DatasetName(kind) << " strings: " << n << std::endl;
+            StringArena arena;
+            GenerateStrings(arena, kind, n);
+            std::vector<const char*> strs = arena.Pointers();
+
+            for (auto & alg: mAlgs) {
+                std::vector<size_t> times;
+                size_t chars = 0;
+                for (size_t i = 0; i < repeat_test; i++) {
+                    alg->SetStrings(strs);
+
+                    time_point<Clock> start = Clock::now();
+                    alg->Sort();
+                    time_point<Clock> end = Clock::now();
+
+                    times.push_back(duration_cast<nanoseconds>(end - start).count());
+                    chars = alg->GetCharsInspected();
+                }
+                if (!alg->isSorted())
+                    std::cerr << alg->GetName() << " failed to sort" << std::endl;
+                std::sort(times.begin(), times.end());
+                mResults.push_back({alg->GetName(), DatasetName(kind), n, arena.Chars(),
+                                    times[times.size() / 2], chars});
+            }
+        }
+    }
+
+    std::cout << "TESTING DONE!" << std::endl;
+    ExportData();
+}
+
+void StringTester::GenerateStrings(StringArena& arena, StringDataset kind, size_t n) {
+    static const char* hosts[] = {"www.example.com", "api.example.com", "cdn.example.net",
+                                  "shop.example.org", "blog.example.io"};
+    static const char* dirs[] = {"users", "orders", "items", "static", "v1", "v2",
+                                 "search", "images", "profile", "settings"};
+    auto word = [](size_t len) {
+        std::string s(len, 'a');
+        for (auto & c: s)
+            c = 'a' + rand() % 26;
+        return s;
+    };
+
+    arena.Reserve(n, n * 64);
+    std::string prefix = "tenant/" + word(40) + "/";
+    for (size_t i = 0; i < n; i++) {
+        switch (kind) {
+            case StringDataset::Random:
+                arena.Add(word(1 + rand() % 32));
+                break;
+            case StringDataset::CommonPrefix:
+                // a handful of long prefixes, the keys differ only at the end
+                arena.Add(prefix + std::to_string(rand() % 8) + "/" + word(8));
+                break;
+            case StringDataset::Url: {
+                std::string url = std::string("https://") + hosts[rand() % 5];
+                for (int d = rand() % 4; d >= 0; d--)
+                    url += std::string("/") + dirs[rand() % 10];
+                url += "/" + std::to_string(rand() % 100000);
+                if (rand() % 3 == 0)
+                    url += "?q=" + word(6);
+                arena.Add(url);
+                break;
+            }
+        }
+    }
+}
+
+std::string StringTester::DatasetName(StringDataset kind) {
+    switch (kind) {
+        case StringDataset::CommonPrefix:
+            return "Common Prefix";
+        case StringDataset::Url:
+            return "URL";
+        default:
+            return "Random";
+    }
+}
+
+void StringTester::ExportData() const {
+    std::ofstream csv;
+    csv.open("output-data/strings.csv");
+    csv << "algorithm,dataset,strings,chars,time,chars inspected,"
+        << "chars inspected per second" << std::endl;
+    for (auto const & e: mResults) {
+        csv << e.mName << ',' << e.mDataset << ',' << e.mNumOfStrings << ','
+            << e.mNumOfChars << ',' << e.mTime << ',' << e.mCharsInspected << ','
+            << e.mCharsInspected * 1e9 / std::max<size_t>(1, e.mTime) << std::endl;
+    }
+    csv.close();
+}
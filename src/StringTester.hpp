@@ -0,0 +1,86 @@
+#ifndef __jch_StringTester_hpp__
+#define __jch_StringTester_hpp__
+
+#include <memory>
+#include <vector>
+
+#include "StringSorting.hpp"
+
+/**
+ * @brief Kinds of generated string datasets.
+ * Random: random lowercase strings of random length.
+ * CommonPrefix: long shared prefixes followed by a short random tail.
+ * Url: URL-like keys built from a few hosts and nested paths.
+ */
+enum class StringDataset { Random, CommonPrefix, Url };
+
+/**
+ * @brief Framework for testing string sorting algorithms.
+ * 
+ */
+class StringTester {
+public:
+    /**
+     * @brief Construct a new StringTester object
+     * 
+     */
+    StringTester() {};
+
+    /**
+     * @brief Adds an algorithm object to the algorithm vector.
+     * 
+     * @param alg_ptr - unique pointer to the algorithm object
+     */
+    void AddAlg(std::unique_ptr<AbstractStringSort> alg_ptr);
+
+    /**
+     * @brief Sorts every dataset of every length with all algorithms.
+     * 
+     * @param lengths - numbers of strings tested
+     * @param repeat_test - number of test repetitions, the median is used
+     */
+    void StartTests(const std::vector<size_t>& lengths, size_t repeat_test = 5);
+
+    /**
+     * @brief Generates a new string dataset.
+     * 
+     * @param arena - arena the strings are appended to
+     * @param kind - kind of the dataset
+     * @param n - number of strings
+     */
+    static void GenerateStrings(StringArena& arena, StringDataset kind, size_t n);
+
+    /**
+     * @brief Returns the printable name of the dataset kind.
+     * 
+     * @param kind - kind of the dataset
+     * @return std::string - name of the dataset
+     */
+    static std::string DatasetName(StringDataset kind);
+
+private:
+    /**
+     * @brief Results of one algorithm on one dataset.
+     * 
+     */
+    struct Entry {
+        std::string mName;
+        std::string mDataset;
+        size_t mNumOfStrings;
+        size_t mNumOfChars;
+        size_t mTime;
+        size_t mCharsInspected;
+    };
+
+    /**
+     * @brief Exports the results into a csv file for further analysis
+     * 
+     */
+    void ExportData() const;
+
+private:
+    std::vector<std::unique_ptr<AbstractStringSort>> mAlgs;
+    std::vector<Entry> mResults;
+};
+
+#endif
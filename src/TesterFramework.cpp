@@ -1,5 +1,11 @@
 #include "TesterFramework.hpp"
 
+#include <sched.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <map>
+#include <sstream>
+
 struct RandomGenerator {
 	int maxValue;
 	RandomGenerator(int max) : maxValue(max) {}
@@ -10,17 +16,49 @@ void TesterFramework::AddAlg(std::unique_ptr<AbstractSort> alg_ptr) {
     mAlgs.push_back(std::move(alg_ptr));
 }
 
-void TesterFramework::StartTests(size_t max_elements, size_t repeat_test,
+bool TesterFramework::StartTests(size_t max_elements, size_t repeat_test,
                                  size_t arrays_tested) {
-    size_t len = 1;
-    for (size_t n = 1; n <= max_elements; n++) {
-        len += 2*n*n;
+    if (mIsolate && arrays_tested > kMaxIsolatedArrays) {
+        std::cerr << "Isolated runs test at most " << kMaxIsolatedArrays << " vectors per length, "
+                  << arrays_tested << " requested" << std::endl;
+        return false;
+    }
+    if (mCalibrate) {
+        mMachine = Roofline::Calibrate();
+        Roofline::Export(mMachine, "output-data/machine.csv");
+    }
+
+    std::vector<size_t> plan = mPlan;
+    for (size_t n = 1, len = 1; mPlan.empty() && n <= max_elements; n++)
+        plan.push_back(len += 2*n*n);
+    if (mMetrics)
+        mMetrics->Start(plan, repeat_test * (arrays_tested + 2));
+
+    Memory::SetPolicy(mPolicy);
+    for (size_t n = 1; n <= plan.size(); n++) {
+        size_t len = plan[n - 1];
+        if (mDataset && len > mDataset->Size())
+            len = mDataset->Size();
+        mLengths.push_back(len);
+        for (auto & alg: mAlgs) {
+            alg->Reserve(len);
+            if (n == 1)
+                alg->ReserveStats(plan.size());
+        }
         std::cout << "Testing length: " << n << std::endl;
-        for (size_t n_arr = 0; n_arr < arrays_tested; n_arr++) {
+        if (mMetrics)
+            mMetrics->BeginPoint(n - 1);
+        if (mIsolate && !RunIsolated(len, repeat_test, arrays_tested)) {
+            std::cerr << "TESTING FAILED, no results exported" << std::endl;
+            return false;
+        }
+        for (size_t n_arr = 0; !mIsolate && n_arr < arrays_tested; n_arr++) {
             GenerateArray(len);
 
             for (auto & alg: mAlgs) {
-                TestMidCase(alg, repeat_test);
+                size_t t = TestMidCase(alg, repeat_test);
+                if (mMetrics)
+                    mMetrics->RecordTime(alg->GetName(), t);
 
                 if (n_arr == 0) {
                     TestBestCase(alg, repeat_test);
@@ -28,41 +66,296 @@ void TesterFramework::StartTests(size_t max_elements, size_t repeat_test,
                 } 
             }
         }
-        for (auto & alg: mAlgs)
-            alg->PushStats(n);
+        for (auto & alg: mAlgs) {
+            alg->AddBytesPerElement(alg->BytesPerElement(len));
+            alg->PushStats(mPlan.empty() ? n : len);
+        }
+        if (mMetrics)
+            mMetrics->EndPoint();
     }
 
     std::cout << "TESTING DONE!" << std::endl; 
     ExportData();
+    return true;
+}
+
+void TesterFramework::SetLengths(std::vector<size_t> lengths) {
+    mPlan = lengths;
+}
+
+void TesterFramework::SetMemoryPolicy(const MemoryPolicy& policy) {
+    mPolicy = policy;
+}
+
+bool TesterFramework::SetDataset(std::shared_ptr<Dataset> dataset) {
+    if (dataset && dataset->Size() == 0) {
+        std::cerr << "Dataset " << dataset->GetName() << " is empty" << std::endl;
+        return false;
+    }
+    // the large copies of every repetition land in huge pages
+    if (dataset && mPolicy.mPages == PageSize::System)
+        mPolicy.mPages = PageSize::Huge2M;
+    mDataset = std::move(dataset);
+    return true;
+}
+
+void TesterFramework::SetCalibration(bool calibrate) {
+    mCalibrate = calibrate;
+}
+
+void TesterFramework::SetCardinality(size_t cardinality) {
+    mCardinality = cardinality;
+}
+
+void TesterFramework::SetOutputFile(std::string path) {
+    mOutputFile = path;
+}
+
+bool TesterFramework::SetIsolation(bool isolate, uint parallel, int node) {
+    mParallelRuns = std::max(1u, parallel);
+    mNumaNode = node;
+    mIsolate = isolate && !IsolationCores().empty();
+    if (isolate && !mIsolate)
+        std::cerr << "No allowed cores" << (node >= 0 ? " on NUMA node " + std::to_string(node) : "")
+                  << ", cannot isolate the runs" << std::endl;
+    return mIsolate == isolate;
+}
+
+void TesterFramework::EnableMetrics(std::string path, int port) {
+    mMetrics = std::make_unique<MetricsExporter>(path, port);
+}
+
+/**
+ * @brief Reads a number from a sysfs file.
+ * 
+ * @param path - path of the file
+ * @return long - the number, -1 if the file is missing
+ */
+static long ReadSysfs(const std::string& path) {
+    std::ifstream f(path);
+    long val = -1;
+    if (!(f >> val))
+        return -1;
+    return val;
+}
+
+std::vector<int> TesterFramework::IsolationCores() const {
+    cpu_set_t allowed;
+    sched_getaffinity(0, sizeof(allowed), &allowed);
+
+    // cpulist of the node, e.g. "0-7,16-23"
+    cpu_set_t node;
+    CPU_ZERO(&node);
+    if (mNumaNode >= 0) {
+        std::ifstream f("/sys/devices/system/node/node" + std::to_string(mNumaNode) + "/cpulist");
+        std::string range;
+        while (std::getline(f, range, ',')) {
+            int lo = -1, hi = -1;
+            char dash;
+            std::istringstream in(range);
+            in >> lo;
+            if (!(in >> dash >> hi))
+                hi = lo;
+            for (int c = lo; c >= 0 && c <= hi; c++)
+                CPU_SET(c, &node);
+        }
+    }
+
+    std::vector<int> cores;
+    for (int c = 0; c < CPU_SETSIZE; c++)
+        if (CPU_ISSET(c, &allowed) && (mNumaNode < 0 || CPU_ISSET(c, &node)))
+            cores.push_back(c);
+    return cores;
+}
+
+bool TesterFramework::RunIsolated(size_t len, size_t repeat_test, size_t arrays_tested) {
+    std::vector<std::vector<int>> arrays;
+    for (size_t n_arr = 0; n_arr < arrays_tested; n_arr++) {
+        GenerateArray(len);
+        arrays.emplace_back(mInput, mInput + mInputLen);
+    }
+
+    std::vector<int> freeCores = IsolationCores();
+    size_t totalCores = freeCores.size();
+    struct Child {
+        size_t mAlg;
+        int mFd;
+        std::vector<int> mCores;
+    };
+    std::map<pid_t, Child> running;
+    size_t runningMt = 0;
+    bool ok = !freeCores.empty();
+
+    // collects the result of one finished child
+    auto reap = [&]() {
+        int status;
+        pid_t pid = wait(&status);
+        auto it = running.find(pid);
+        if (it == running.end())
+            return;
+        Child& c = it->second;
+        IsolatedResult res;
+        std::unique_ptr<AbstractSort>& alg = mAlgs[c.mAlg];
+        if (read(c.mFd, &res, sizeof(res)) == (ssize_t)sizeof(res)) {
+            for (size_t i = 0; i < arrays_tested; i++) {
+                alg->AddMidCaseTime(res.mMidCaseTimes[i]);
+                if (mMetrics)
+                    mMetrics->RecordTime(alg->GetName(), res.mMidCaseTimes[i]);
+            }
+            alg->AddBestCaseTime(res.mBestCaseTime);
+            alg->AddWorstCaseTime(res.mWorstCaseTime);
+            alg->AddCpuInfo(res.mCore, res.mFreqMHz, res.mTurbo);
+            alg->AddMemoryUsage(res.mMemory);
+        } else {
+            // no made up times, the caller drops the whole run
+            std::cerr << alg->GetName() << " child failed" << std::endl;
+            ok = false;
+        }
+        close(c.mFd);
+        runningMt -= alg->GetThreads() > 1;
+        freeCores.insert(freeCores.end(), c.mCores.begin(), c.mCores.end());
+        running.erase(it);
+    };
+
+    for (size_t a = 0; ok && a < mAlgs.size(); a++) {
+        std::unique_ptr<AbstractSort>& alg = mAlgs[a];
+        size_t need = std::min<size_t>(std::max(1u, alg->GetThreads()), totalCores);
+        bool mt = alg->GetThreads() > 1;
+        // multithread runs get the machine alone, single thread runs share it
+        while (!running.empty() && (freeCores.size() < need || runningMt > 0 || mt ||
+                                    running.size() >= mParallelRuns))
+            reap();
+
+        Child c = {a, -1, std::vector<int>(freeCores.begin(), freeCores.begin() + need)};
+        freeCores.erase(freeCores.begin(), freeCores.begin() + need);
+        int fds[2];
+        if (pipe(fds) != 0) {
+            std::cerr << "pipe failed" << std::endl;
+            ok = false;
+            break;
+        }
+
+        pid_t pid = fork();
+        if (pid == 0) {
+            close(fds[0]);
+            cpu_set_t set;
+            CPU_ZERO(&set);
+            for (int core: c.mCores)
+                CPU_SET(core, &set);
+            sched_setaffinity(0, sizeof(set), &set);
+
+            IsolatedResult res;
+            std::string cpu = "/sys/devices/system/cpu/";
+            for (size_t n_arr = 0; n_arr < arrays_tested; n_arr++) {
+                mInput = arrays[n_arr].data();
+                res.mMidCaseTimes[n_arr] = TimeMidCase(*alg, repeat_test, res.mMemory);
+            }
+            mInput = arrays[0].data();
+            res.mBestCaseTime = TestBestCase(alg, repeat_test);
+            res.mWorstCaseTime = TestWorstCase(alg, repeat_test);
+            res.mCore = c.mCores[0];
+            // read right after the runs, the core may still be boosted
+            res.mFreqMHz = ReadSysfs(cpu + "cpu" + std::to_string(res.mCore)
+                                     + "/cpufreq/scaling_cur_freq");
+            res.mFreqMHz = res.mFreqMHz < 0 ? -1 : res.mFreqMHz / 1000;
+            long noTurbo = ReadSysfs(cpu + "intel_pstate/no_turbo");
+            res.mTurbo = noTurbo >= 0 ? !noTurbo : ReadSysfs(cpu + "cpufreq/boost");
+
+            ssize_t w = write(fds[1], &res, sizeof(res));
+            _exit(w == (ssize_t)sizeof(res) ? 0 : 1);
+        }
+        close(fds[1]);
+        if (pid < 0) {
+            std::cerr << "fork failed" << std::endl;
+            close(fds[0]);
+            ok = false;
+            break;
+        }
+        c.mFd = fds[0];
+        runningMt += mt;
+        running[pid] = c;
+    }
+    while (!running.empty())
+        reap();
+    return ok;
 }
 
 void TesterFramework::GenerateArray(int len) {
-    mArray = std::vector<int>(len);
-    std::generate(mArray.begin(), mArray.end(), RandomGenerator(2 * len));
+    mInputLen = len;
+    if (mDataset) {
+        // random window of the mapped keys, nothing is copied here
+        size_t offset = rand() % (mDataset->Size() - len + 1);
+        mInput = mDataset->Data() + offset;
+        return;
+    }
+    mArray = IntArray(len);
+    std::generate(mArray.begin(), mArray.end(),
+                  RandomGenerator(mCardinality ? mCardinality : 2 * len));
+    mInput = mArray.data();
 }  
 
-void TesterFramework::TestMidCase(std::unique_ptr<AbstractSort>& alg, size_t rep) {
+size_t TesterFramework::Measure(AbstractSort& alg, size_t len, size_t rep) {
+    PrepareInput(len);
+    return Measure(alg, rep);
+}
+
+size_t TesterFramework::PrepareInput(size_t len) {
+    if (mDataset && len > mDataset->Size())
+        len = mDataset->Size();
+    Memory::SetPolicy(mPolicy);
+    GenerateArray(len);
+    return mInputLen;
+}
+
+size_t TesterFramework::Measure(AbstractSort& alg, size_t rep) {
+    Memory::SetPolicy(mPolicy);
+    alg.Reserve(mInputLen);
+    AllocUsage usage;
+    return TimeMidCase(alg, rep, usage);
+}
+
+size_t TesterFramework::TimeMidCase(AbstractSort& alg, size_t rep, AllocUsage& usage) {
     size_t t = 0; 
     for (size_t i = 0; i < rep; i++) {
-        alg->SetArray(mArray);
+        alg.SetArray(mInput, mInputLen);
+
+        // the first sort is also accounted for its memory
+        bool account = i == 0;
+        long rss = account && AllocCounter::ResetPeakRss() ? AllocCounter::RssKb() : -1;
+        AllocUsage before = AllocCounter::Read();
 
         time_point<Clock> start = Clock::now();
-        alg->Sort();
+        alg.Sort();
         time_point<Clock> end = Clock::now();
+
+        AllocUsage after = AllocCounter::Read();
+        if (account) {
+            usage.mCount = std::max(usage.mCount, after.mCount - before.mCount);
+            usage.mBytes = std::max(usage.mBytes, after.mBytes - before.mBytes);
+            if (rss >= 0)
+                usage.mPeakRssKb = std::max(usage.mPeakRssKb, AllocCounter::PeakRssKb() - rss);
+        }
         
         nanoseconds diff = duration_cast<nanoseconds>(end - start);
         t += diff.count();
     }
-    t /= rep;
+    return t / rep;
+}
+
+size_t TesterFramework::TestMidCase(std::unique_ptr<AbstractSort>& alg, size_t rep) {
+    AllocUsage usage;
+    size_t t = TimeMidCase(*alg, rep, usage);
     // std::cout << "MidCase: " << t << std::endl;
     alg->AddMidCaseTime(t);
+    alg->AddMemoryUsage(usage);
+    return t;
 }
 
-void TesterFramework::TestBestCase(std::unique_ptr<AbstractSort>& alg, size_t rep) {
+size_t TesterFramework::TestBestCase(std::unique_ptr<AbstractSort>& alg, size_t rep) {
     size_t t = 0; 
-    mSorted = std::vector<int>(mArray);
+    mSorted.assign(mInput, mInput + mInputLen);
     std::sort(mSorted.begin(),mSorted.end());
-    alg->SetArray(mSorted);
+    alg->SetArray(mSorted.data(), mSorted.size());
     for (size_t i = 0; i < rep; i++) {
         time_point<Clock> start = Clock::now();
         alg->Sort();
@@ -74,15 +367,16 @@ void TesterFramework::TestBestCase(std::unique_ptr<AbstractSort>& alg, size_t re
     t /= rep;
     // std::cout << "BestCase: " << t << std::endl;
     alg->AddBestCaseTime(t);
+    return t;
 }
 
-void TesterFramework::TestWorstCase(std::unique_ptr<AbstractSort>& alg, size_t rep) {
+size_t TesterFramework::TestWorstCase(std::unique_ptr<AbstractSort>& alg, size_t rep) {
     size_t t = 0; 
-    mSorted = std::vector<int>(mArray);
+    mSorted.assign(mInput, mInput + mInputLen);
     std::sort(mSorted.begin(),mSorted.end());
     std::reverse(mSorted.begin(), mSorted.end());
     for (size_t i = 0; i < rep; i++) {
-        alg->SetArray(mSorted);
+        alg->SetArray(mSorted.data(), mSorted.size());
 
         time_point<Clock> start = Clock::now();
         alg->Sort();
@@ -94,38 +388,108 @@ void TesterFramework::TestWorstCase(std::unique_ptr<AbstractSort>& alg, size_t r
     t /= rep;
     // std::cout << "WorstCase: " << t << std::endl;
     alg->AddWorstCaseTime(t);
+    return t;
+}
+
+double TesterFramework::Bandwidth(std::unique_ptr<AbstractSort>& alg, size_t k) {
+    const StatsColumns& cols = alg->GetStats().GetColumns();
+    return cols.mBytesPerElement[k] * mLengths[k] / std::max<size_t>(1, cols.mMidCaseTime[k]);
 }
 
 void TesterFramework::ExportData() {
     std::ofstream csv;
-    csv.open ("output-data/results.csv");
+    csv.open (mOutputFile);
 
     csv << ",n";
-    for (auto const & stat: mAlgs[0]->GetStats().GetHistory())
-        csv << ',' << stat->mNumOfElements;
+    for (auto const & n: mAlgs[0]->GetStats().GetColumns().mNumOfElements)
+        csv << ',' << n;
     csv << std::endl;
 
     for (auto & alg: mAlgs) {
         const AlgStats& stats = alg->GetStats();
-        for (uint i = 0; i < 3; i++){
+        const StatsColumns& cols = stats.GetColumns();
+        for (uint i = 0; i < 12; i++){
+            if ((i == 4 || i == 5) && !mCalibrate)
+                continue;
+            if (i >= 6 && i <= 8 && !mIsolate)
+                continue;
             switch (i)
             {
                 case 0:
                     csv << alg->GetName() << "," << "Best Case";
-                    for (auto const & stat: stats.GetHistory())
-                        csv << ',' << stat->mBestCaseTime;
+                    for (auto const & v: cols.mBestCaseTime)
+                        csv << ',' << v;
                     csv << std::endl;
                     break;
                 case 1:
                     csv << alg->GetName() << "," << "Most Likely Case";
-                    for (auto const & stat: stats.GetHistory())
-                        csv << ',' << stat->mMidCaseTime;
+                    for (auto const & v: cols.mMidCaseTime)
+                        csv << ',' << v;
                     csv << std::endl;
                     break;
                 case 2:
                     csv << alg->GetName() << "," << "Worst Case";
-                    for (auto const & stat: stats.GetHistory())
-                        csv << ',' << stat->mWorstCaseTime;
+                    for (auto const & v: cols.mWorstCaseTime)
+                        csv << ',' << v;
+                    csv << std::endl;
+                    break;
+                case 3:
+                    csv << alg->GetName() << "," << "Bytes Per Element";
+                    for (auto const & v: cols.mBytesPerElement)
+                        csv << ',' << v;
+                    csv << std::endl;
+                    break;
+                case 4:
+                    // bytes per nanosecond equals GB/s
+                    csv << alg->GetName() << "," << "Modeled Bandwidth (GB/s)";
+                    for (size_t k = 0; k < stats.Size(); k++)
+                        csv << ',' << Bandwidth(alg, k);
+                    csv << std::endl;
+                    break;
+                case 5:
+                    // vectors fitting in the cache are not bound by the DRAM roof
+                    csv << alg->GetName() << "," << "Modeled Roofline Fraction";
+                    for (size_t k = 0; k < stats.Size(); k++) {
+                        csv << ',';
+                        if (mLengths[k] * sizeof(int) > mMachine.mCacheBytes)
+                            csv << Bandwidth(alg, k) / mMachine.Roof(alg->GetThreads());
+                    }
+                    csv << std::endl;
+                    break;
+                case 6:
+                    csv << alg->GetName() << "," << "Core";
+                    for (auto const & v: cols.mCore)
+                        csv << ',' << v;
+                    csv << std::endl;
+                    break;
+                case 7:
+                    csv << alg->GetName() << "," << "Frequency (MHz)";
+                    for (auto const & v: cols.mFreqMHz)
+                        csv << ',' << v;
+                    csv << std::endl;
+                    break;
+                case 8:
+                    csv << alg->GetName() << "," << "Turbo";
+                    for (auto const & v: cols.mTurbo)
+                        csv << ',' << v;
+                    csv << std::endl;
+                    break;
+                case 9:
+                    csv << alg->GetName() << "," << "Allocations";
+                    for (auto const & v: cols.mAllocCount)
+                        csv << ',' << v;
+                    csv << std::endl;
+                    break;
+                case 10:
+                    csv << alg->GetName() << "," << "Allocated Bytes";
+                    for (auto const & v: cols.mAllocBytes)
+                        csv << ',' << v;
+                    csv << std::endl;
+                    break;
+                case 11:
+                    csv << alg->GetName() << "," << "Peak RSS Growth (KB)";
+                    for (auto const & v: cols.mPeakRssKb)
+                        csv << ',' << v;
                     csv << std::endl;
                     break;
                 default:
@@ -134,4 +498,43 @@ void TesterFramework::ExportData() {
         }
     }
     csv.close();
+    ExportRanking();
+}
+
+void TesterFramework::ExportRanking() {
+    std::string path = mOutputFile;
+    size_t ext = path.rfind(".csv");
+    path.insert(ext == std::string::npos ? path.size() : ext, "-ranking");
+    std::ofstream csv;
+    csv.open (path);
+
+    csv << "n,Algorithm,Most Likely Case,Time Rank,Allocated Bytes,Allocations,Memory Rank,"
+        << "Peak RSS Growth (KB)" << std::endl;
+    std::vector<size_t> byTime(mAlgs.size()), byMemory(mAlgs.size()), timeRank(mAlgs.size());
+    for (size_t k = 0; k < mLengths.size(); k++) {
+        auto col = [&](size_t a) -> const StatsColumns& {
+            return mAlgs[a]->GetStats().GetColumns();
+        };
+        for (size_t a = 0; a < mAlgs.size(); a++)
+            byTime[a] = byMemory[a] = a;
+        std::stable_sort(byTime.begin(), byTime.end(), [&](size_t a, size_t b) {
+            return col(a).mMidCaseTime[k] < col(b).mMidCaseTime[k];
+        });
+        // the allocation counters are deterministic, the RSS growth depends on
+        // page reuse and the kernel, so it is only reported
+        std::stable_sort(byMemory.begin(), byMemory.end(), [&](size_t a, size_t b) {
+            return std::make_pair(col(a).mAllocBytes[k], col(a).mAllocCount[k]) <
+                   std::make_pair(col(b).mAllocBytes[k], col(b).mAllocCount[k]);
+        });
+        for (size_t r = 0; r < byTime.size(); r++)
+            timeRank[byTime[r]] = r + 1;
+        for (size_t r = 0; r < byMemory.size(); r++) {
+            size_t a = byMemory[r];
+            csv << col(a).mNumOfElements[k] << ',' << mAlgs[a]->GetName() << ','
+                << col(a).mMidCaseTime[k] << ',' << timeRank[a] << ','
+                << col(a).mAllocBytes[k] << ',' << col(a).mAllocCount[k] << ',' << r + 1 << ','
+                << col(a).mPeakRssKb[k] << std::endl;
+        }
+    }
+    csv.close();
 }
\ No newline at end of file
@@ -7,6 +7,9 @@
 #include <fstream>
 
 #include "Sorting.hpp" 
+#include "Roofline.hpp"
+#include "Metrics.hpp"
+#include "Dataset.hpp"
 
 using Clock = std::chrono::steady_clock;
 using std::chrono::time_point;
@@ -37,12 +40,157 @@ public:
      * 
      * @param max_elements - factor of vector lenght generation
      * @param repeat_test - number test repetitions to get a time average
-     * @param arrays_tested - number of uniqie vectors tested for middle case scenario
+     * @param arrays_tested - number of uniqie vectors tested for middle case scenario,
+     * at most kMaxIsolatedArrays with isolation
+     * @return true - the results were exported
+     * @return false - an isolated run failed or too many vectors were
+     * requested, nothing was exported
      */
-    void StartTests(size_t max_elements = 15, size_t repeat_test = 1000,
+    bool StartTests(size_t max_elements = 15, size_t repeat_test = 1000,
                     size_t arrays_tested = 3);
 
+    /**
+     * @brief Measures the middle case time of the algorithm on one new
+     * vector without recording it into the algorithm statistics.
+     * 
+     * @param alg - measured algorithm
+     * @param len - vector length
+     * @param rep - number of repetitions to get a time average
+     * @return size_t - average time in nanoseconds
+     */
+    size_t Measure(AbstractSort& alg, size_t len, size_t rep);
+
+    /**
+     * @brief Generates the vector used by the following Measure calls,
+     * so that several algorithms can be compared on the same keys.
+     * 
+     * @param len - vector length
+     * @return size_t - actual length, a dataset can be shorter
+     */
+    size_t PrepareInput(size_t len);
+
+    /**
+     * @brief Measures the middle case time of the algorithm on the vector
+     * from the last PrepareInput call without recording it into the
+     * algorithm statistics.
+     * 
+     * @param alg - measured algorithm
+     * @param rep - number of repetitions to get a time average
+     * @return size_t - average time in nanoseconds
+     */
+    size_t Measure(AbstractSort& alg, size_t rep);
+
+    /**
+     * @brief Enables or disables the memory roofline calibration before the tests.
+     * 
+     * @param calibrate - run the calibration
+     */
+    void SetCalibration(bool calibrate);
+
+    /**
+     * @brief Tests the given lengths instead of the 1 + sum(2*n*n) sequence.
+     * The exported n row then holds the lengths.
+     * 
+     * @param lengths - tested vector lengths
+     */
+    void SetLengths(std::vector<size_t> lengths);
+
+    /**
+     * @brief Sets the memory policy of the tested vectors and of the
+     * algorithm buffers for the whole test run.
+     * 
+     * @param policy - page size and NUMA placement
+     */
+    void SetMemoryPolicy(const MemoryPolicy& policy);
+
+    /**
+     * @brief Takes the tested vectors from a dataset instead of generating
+     * them. Every vector is a random window of the dataset keys and the
+     * lengths are capped by the size of the dataset. Unless a page size
+     * was set, the working buffers then ask for 2 MB huge pages, falling
+     * back to transparent huge pages when none are reserved.
+     * 
+     * @param dataset - loaded dataset, nullptr to generate random vectors
+     * @return true - the dataset is used
+     * @return false - the dataset holds no keys
+     */
+    bool SetDataset(std::shared_ptr<Dataset> dataset);
+
+    /**
+     * @brief Limits the number of distinct keys in the generated vectors.
+     * 
+     * @param cardinality - number of distinct keys, 0 draws keys from [0, 2*len)
+     */
+    void SetCardinality(size_t cardinality);
+
+    /**
+     * @brief Set the path of the exported csv file
+     * 
+     * @param path - path of the csv file
+     */
+    void SetOutputFile(std::string path);
+
+    /**
+     * @brief Runs every (algorithm, length) measurement in a forked child
+     * pinned to dedicated cores. Single thread algorithms may run
+     * concurrently on separate cores, multithread ones always run alone.
+     * 
+     * @param isolate - enable process isolation
+     * @param parallel - maximal number of concurrent single thread measurements
+     * @param node - NUMA node whose cores are used, -1 for all allowed cores
+     * @return true - the setting was applied
+     * @return false - there is no allowed core to isolate the runs on
+     */
+    bool SetIsolation(bool isolate, uint parallel = 1, int node = -1);
+
+    /**
+     * @brief Publishes the progress of the tests in the Prometheus text format.
+     * 
+     * @param path - periodically rewritten metrics file, empty to disable
+     * @param port - localhost HTTP port serving the metrics, 0 to disable
+     */
+    void EnableMetrics(std::string path, int port = 0);
+
+    /**
+     * @brief Largest number of middle case vectors of an isolated run,
+     * the child reports their times in a fixed size result.
+     * 
+     */
+    static constexpr size_t kMaxIsolatedArrays = 64;
+
 private:
+    /**
+     * @brief Results of one isolated (algorithm, length) measurement.
+     * 
+     */
+    struct IsolatedResult {
+        size_t mBestCaseTime;
+        size_t mWorstCaseTime;
+        int mCore;
+        long mFreqMHz;
+        int mTurbo;
+        size_t mMidCaseTimes[kMaxIsolatedArrays];
+        AllocUsage mMemory;
+    };
+
+    /**
+     * @brief Measures all algorithms on one length, each in its own child process.
+     * 
+     * @param len - lenght of the tested vectors
+     * @param repeat_test - number test repetitions to get a time average
+     * @param arrays_tested - number of uniqie vectors tested for middle case scenario
+     * @return true - all children reported their results
+     * @return false - a child failed, the stats of the length are incomplete
+     */
+    bool RunIsolated(size_t len, size_t repeat_test, size_t arrays_tested);
+
+    /**
+     * @brief Returns the cores the isolated measurements may use.
+     * 
+     * @return std::vector<int> - core ids
+     */
+    std::vector<int> IsolationCores() const;
+
     /**
      * @brief Generates a new random vector for testing.
      * 
@@ -50,35 +198,69 @@ private:
      */
     void GenerateArray(int len);
 
+    /**
+     * @brief Sorts the current vector rep times
+     * The allocations and the peak RSS growth of the first sort are
+     * merged into usage, keeping the larger values.
+     * 
+     * @param alg - tested algorithm
+     * @param rep - number test repetitions to get a time average
+     * @param usage - memory used by one sort
+     * @return size_t - average time in nanoseconds
+     */
+    size_t TimeMidCase(AbstractSort& alg, size_t rep, AllocUsage& usage);
+
     /**
      * @brief Runs the middle case scenario sorting test
      * 
      * @param alg - tested algorithm
      * @param rep - number test repetitions to get a time average
+     * @return size_t - average time in nanoseconds
      */
-    void TestMidCase(std::unique_ptr<AbstractSort>& alg, size_t rep);
+    size_t TestMidCase(std::unique_ptr<AbstractSort>& alg, size_t rep);
 
     /**
      * @brief Runs the best case scenario sorting test
      * 
      * @param alg - tested algorithm
      * @param rep - number test repetitions to get a time average
+     * @return size_t - average time in nanoseconds
      */
-    void TestBestCase(std::unique_ptr<AbstractSort>& alg, size_t rep);
+    size_t TestBestCase(std::unique_ptr<AbstractSort>& alg, size_t rep);
     
     /**
      * @brief Runs the worst case scenario sorting test
      * 
      * @param alg - tested algorithm
      * @param rep - number test repetitions to get a time average
+     * @return size_t - average time in nanoseconds
      */
-    void TestWorstCase(std::unique_ptr<AbstractSort>& alg, size_t rep);
+    size_t TestWorstCase(std::unique_ptr<AbstractSort>& alg, size_t rep);
+
+    /**
+     * @brief Returns the bandwidth of the modeled traffic in the middle case
+     * scenario, i.e. the bytes per element estimated by the algorithm over
+     * the measured time. Cache hits are not accounted for, so it is only
+     * comparable to the DRAM roof for vectors exceeding the last level cache.
+     * 
+     * @param alg - tested algorithm
+     * @param k - index of the test iteration
+     * @return double - modeled bandwidth in bytes per nanosecond
+     */
+    double Bandwidth(std::unique_ptr<AbstractSort>& alg, size_t k);
 
     /**
      * @brief Exports the testing history into a csv file for further analysis
      * 
      */
     void ExportData();
+
+    /**
+     * @brief Exports the algorithms ranked by allocated memory and by time for every
+     * length into <output file>-ranking.csv
+     * 
+     */
+    void ExportRanking();
     
 private:
     /**
@@ -91,13 +273,39 @@ private:
      * @brief Original vector tested in current iteration.
      * 
      */
-    std::vector<int> mArray;
+    IntArray mArray;
+
+    /**
+     * @brief Keys tested in current iteration, points either into mArray
+     * or into the dataset.
+     * 
+     */
+    const int* mInput = nullptr;
+    size_t mInputLen = 0;
 
     /**
-     * @brief Sorted copy of mArray vector.
+     * @brief Sorted copy of the tested keys.
      * 
      */
-    std::vector<int> mSorted;
+    IntArray mSorted;
+
+    /**
+     * @brief Vector lengths of the test iterations.
+     * 
+     */
+    std::vector<size_t> mLengths;
+
+    bool mCalibrate = true;
+    size_t mCardinality = 0;
+    std::string mOutputFile = "output-data/results.csv";
+    bool mIsolate = false;
+    uint mParallelRuns = 1;
+    int mNumaNode = -1;
+    std::unique_ptr<MetricsExporter> mMetrics;
+    MachineProfile mMachine;
+    std::shared_ptr<Dataset> mDataset;
+    std::vector<size_t> mPlan;
+    MemoryPolicy mPolicy;
 };
 
 #endif
\ No newline at end of file
@@ -0,0 +1,151 @@
+#include "Trace.hpp"
+
+#include <chrono>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+namespace Trace {
+
+/**
+ * @brief One finished span.
+ * 
+ */
+struct Event {
+    const char* mName;
+    uint64_t mBegin;
+    uint64_t mEnd;
+};
+
+/**
+ * @brief Ring buffer of one thread, the oldest spans get overwritten.
+ * 
+ */
+struct Buffer {
+    static constexpr size_t kCapacity = 1 << 16;
+
+    Buffer(size_t tid) : mTid(tid), mEvents(kCapacity) {}
+
+    size_t mTid;
+    size_t mCount = 0;
+    size_t mSuppressed = 0;
+    std::vector<Event> mEvents;
+};
+
+/**
+ * @brief Buffers of all threads that ever traced a span. The buffers
+ * outlive their threads, std::async threads end before the dump.
+ * A finished thread returns its buffer to gFree and the next new thread
+ * continues in it, so the memory grows with the number of concurrent
+ * threads, not with the number of threads ever started.
+ * 
+ */
+static std::mutex gMutex;
+static std::vector<std::unique_ptr<Buffer>> gBuffers;
+static std::vector<Buffer*> gFree;
+
+/**
+ * @brief Reference point for converting ticks to microseconds.
+ * 
+ */
+static const uint64_t gStartTicks = Now();
+static const std::chrono::steady_clock::time_point gStartTime =
+    std::chrono::steady_clock::now();
+
+/**
+ * @brief Holds the buffer of one thread and releases it at the thread exit.
+ * 
+ */
+struct BufferOwner {
+    Buffer* mBuf = nullptr;
+
+    ~BufferOwner() {
+        if (!mBuf)
+            return;
+        std::lock_guard<std::mutex> lock(gMutex);
+        mBuf->mSuppressed = 0;
+        gFree.push_back(mBuf);
+    }
+};
+
+static Buffer& LocalBuffer() {
+    thread_local BufferOwner owner;
+    if (!owner.mBuf) {
+        std::lock_guard<std::mutex> lock(gMutex);
+        if (!gFree.empty()) {
+            owner.mBuf = gFree.back();
+            gFree.pop_back();
+        } else {
+            gBuffers.push_back(std::make_unique<Buffer>(gBuffers.size()));
+            owner.mBuf = gBuffers.back().get();
+        }
+    }
+    return *owner.mBuf;
+}
+
+uint64_t Now() {
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#else
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+}
+
+void Record(const char* name, uint64_t begin, uint64_t end) {
+    Buffer& buf = LocalBuffer();
+    buf.mEvents[buf.mCount++ % Buffer::kCapacity] = {name, begin, end};
+}
+
+void Dump(const std::string& path) {
+    // ticks per microsecond measured over the whole traced interval
+    double us = std::chrono::duration<double, std::micro>(
+        std::chrono::steady_clock::now() - gStartTime).count();
+    double ticksPerUs = us > 0 ? (Now() - gStartTicks) / us : 1;
+
+    std::lock_guard<std::mutex> lock(gMutex);
+    std::ofstream json(path);
+    json << "{\"traceEvents\":[";
+    bool first = true;
+    for (auto const & buf: gBuffers) {
+        size_t cnt = std::min(buf->mCount, Buffer::kCapacity);
+        for (size_t i = buf->mCount - cnt; i < buf->mCount; i++) {
+            const Event& e = buf->mEvents[i % Buffer::kCapacity];
+            json << (first ? "" : ",") << std::endl
+                 << "{\"name\":\"" << e.mName << "\",\"ph\":\"X\",\"pid\":1"
+                 << ",\"tid\":" << buf->mTid
+                 << ",\"ts\":" << (e.mBegin - gStartTicks) / ticksPerUs
+                 << ",\"dur\":" << (e.mEnd - e.mBegin) / ticksPerUs << "}";
+            first = false;
+        }
+    }
+    json << std::endl << "]}" << std::endl;
+}
+
+void Reset() {
+    std::lock_guard<std::mutex> lock(gMutex);
+    for (auto & buf: gBuffers)
+        buf->mCount = 0;
+}
+
+Span::Span(const char* name, bool leaf) : mName(name), mLeaf(leaf) {
+    Buffer& buf = LocalBuffer();
+    mActive = buf.mSuppressed == 0;
+    if (mLeaf)
+        buf.mSuppressed++;
+    mBegin = mActive ? Now() : 0;
+}
+
+Span::~Span() {
+    if (mActive)
+        Record(mName, mBegin, Now());
+    if (mLeaf)
+        LocalBuffer().mSuppressed--;
+}
+
+}
@@ -0,0 +1,78 @@
+#ifndef __jch_Trace_hpp__
+#define __jch_Trace_hpp__
+
+#include <cstdint>
+#include <string>
+
+/**
+ * @brief Span tracing of the parallel sorts.
+ * Spans are kept in thread local ring buffers and dumped as Chrome
+ * trace JSON (chrome://tracing, ui.perfetto.dev). Tracing is compiled
+ * in only when SORT_TRACING is defined, otherwise all the macros
+ * expand to nothing.
+ */
+namespace Trace {
+    /**
+     * @brief Returns the current timestamp in ticks (rdtsc on x86,
+     * steady_clock nanoseconds elsewhere).
+     * 
+     * @return uint64_t - timestamp
+     */
+    uint64_t Now();
+
+    /**
+     * @brief Stores one finished span into the ring buffer of the calling thread.
+     * 
+     * @param name - span name, must be a string literal
+     * @param begin - timestamp of the span start
+     * @param end - timestamp of the span end
+     */
+    void Record(const char* name, uint64_t begin, uint64_t end);
+
+    /**
+     * @brief Writes all recorded spans as Chrome trace JSON.
+     * Must not be called while traced sorts are running.
+     * 
+     * @param path - path of the output file
+     */
+    void Dump(const std::string& path);
+
+    /**
+     * @brief Drops all recorded spans.
+     * 
+     */
+    void Reset();
+
+    /**
+     * @brief Records a span for the lifetime of the object.
+     * A leaf span suppresses all spans nested in it, so the sequential
+     * parts of the recursion cost one span instead of one per call.
+     */
+    class Span {
+    public:
+        Span(const char* name, bool leaf = false);
+        ~Span();
+
+    private:
+        const char* mName;
+        uint64_t mBegin;
+        bool mActive;
+        bool mLeaf;
+    };
+}
+
+#ifdef SORT_TRACING
+#define TRACE_CONCAT_(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT_(a, b)
+#define TRACE_SPAN(name) Trace::Span TRACE_CONCAT(trace_span_, __LINE__)(name)
+#define TRACE_LEAF(name) Trace::Span TRACE_CONCAT(trace_span_, __LINE__)(name, true)
+#define TRACE_DUMP(path) Trace::Dump(path)
+#define TRACE_RESET() Trace::Reset()
+#else
+#define TRACE_SPAN(name)
+#define TRACE_LEAF(name)
+#define TRACE_DUMP(path)
+#define TRACE_RESET()
+#endif
+
+#endif
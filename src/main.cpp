@@ -1,8 +1,14 @@
 #include <iostream>
 #include <ctime>
+#include <csignal>
 
 #include "src/TesterFramework.hpp"
 #include "src/Sorting.hpp"
+#include "src/Scaling.hpp"
+#include "src/Service.hpp"
+#include "src/StringTester.hpp"
+#include "src/Trace.hpp"
+#include "src/Autotuner.hpp"
 
 
 using namespace std;
@@ -14,13 +20,204 @@ using namespace std;
  *
  */
 
+/**
+ * @brief Runs every parallel algorithm on 1 to the number of allowed cpus.
+ * 
+ * @param pin - pin the threads of a run to dedicated cores
+ */
+void RunScaling(bool pin) {
+    ScalingTester scaling = ScalingTester(pin);
+    scaling.AddAlg(make_unique<MergeSort>(),
+                   [](uint th) { return make_unique<MtMergeSort>(th); });
+    scaling.AddAlg(make_unique<QuickSort>(1),
+                   [](uint th) { return make_unique<MtQuickSort>(th); });
+    scaling.AddAlg(make_unique<KWayMergeSort>(),
+                   [](uint th) { return make_unique<MtKWayMergeSort>(th); });
+    scaling.AddAlg(make_unique<RangeSort>(),
+                   [](uint th) { return make_unique<RangeSort>(th); });
+    scaling.StartScaling({10000, 100000, 1000000});
+}
+
+/**
+ * @brief Compares the quick sort partitioning schemes on inputs with
+ * a limited number of distinct keys.
+ * 
+ */
+void RunCardinality() {
+    for (size_t card: {2, 16, 256, 4096, 0}) {
+        cout << "Cardinality: " << card << endl;
+        TesterFramework tester = TesterFramework();
+        tester.SetCalibration(false);
+        tester.SetCardinality(card);
+        tester.SetOutputFile("output-data/cardinality-" + to_string(card) + ".csv");
+        for (PartitionScheme ps: {PartitionScheme::Lomuto, PartitionScheme::ThreeWay,
+                                  PartitionScheme::DualPivot}) {
+            tester.AddAlg(make_unique<QuickSort>(1, ps));
+            tester.AddAlg(make_unique<MtQuickSort>(4, ps));
+        }
+        tester.StartTests(15, 100);
+    }
+}
+
+/**
+ * @brief Runs the parallel algorithms on large vectors once per memory policy.
+ * Huge page policies without reserved pages are skipped, otherwise their
+ * results would silently measure transparent huge pages.
+ * 
+ * @param policies - names of the tested memory policies
+ */
+void RunMemory(const vector<string>& policies) {
+    for (const string& name: policies) {
+        MemoryPolicy policy = MemoryPolicy::Parse(name);
+        bool huge = policy.mPages == PageSize::Huge2M || policy.mPages == PageSize::Huge1G;
+        if (huge && !Memory::HugePagesAvailable(policy.mPages)) {
+            cerr << "No reserved huge pages for " << policy.Name() << ", skipping it" << endl;
+            continue;
+        }
+        cout << "Memory policy: " << policy.Name() << endl;
+        size_t fallbacks = Memory::HugePageFallbacks();
+        TesterFramework tester = TesterFramework();
+        tester.SetCalibration(false);
+        tester.SetMemoryPolicy(policy);
+        tester.SetLengths({1 << 20, 1 << 22, 1 << 24, 1 << 26});
+        tester.SetOutputFile("output-data/results-" + policy.Name() + ".csv");
+        tester.AddAlg(make_unique<MtMergeSort>(4));
+        tester.AddAlg(make_unique<MtQuickSort>(4));
+        tester.AddAlg(make_unique<MtKWayMergeSort>(4));
+        tester.AddAlg(make_unique<RangeSort>(4));
+        tester.StartTests(0, 3, 1);
+        if (Memory::HugePageFallbacks() > fallbacks)
+            cerr << "Huge page pool exhausted, " << Memory::HugePageFallbacks() - fallbacks
+                 << " buffers of results-" << policy.Name()
+                 << ".csv used transparent huge pages" << endl;
+    }
+}
+
+/**
+ * @brief Compares the string sorting algorithms on the generated string datasets.
+ * 
+ */
+void RunStrings() {
+    StringTester tester = StringTester();
+    tester.AddAlg(make_unique<MultikeyQuickSort>());
+    tester.AddAlg(make_unique<MsdRadixSort>());
+    tester.AddAlg(make_unique<MtLcpMergeSort>(1));
+    tester.AddAlg(make_unique<MtLcpMergeSort>(4));
+    tester.StartTests({10000, 100000, 1000000});
+}
+
+/**
+ * @brief Creates an algorithm object by its command line name.
+ * 
+ * @param name - insert, merge, quick, quick3, dualpivot, kway, mtmerge, mtquick,
+ * mtkway, range or mtrange
+ * @param th - number of threads of the multithread algorithms
+ * @return unique_ptr<AbstractSort> - algorithm object, nullptr for unknown names
+ */
+unique_ptr<AbstractSort> MakeAlg(const string& name, uint th) {
+    if (name == "insert") return make_unique<InsertSort>();
+    if (name == "merge") return make_unique<MergeSort>();
+    if (name == "quick") return make_unique<QuickSort>(1);
+    if (name == "quick3") return make_unique<QuickSort>(1, PartitionScheme::ThreeWay);
+    if (name == "dualpivot") return make_unique<QuickSort>(1, PartitionScheme::DualPivot);
+    if (name == "kway") return make_unique<KWayMergeSort>();
+    if (name == "mtmerge") return make_unique<MtMergeSort>(th);
+    if (name == "mtquick") return make_unique<MtQuickSort>(th);
+    if (name == "mtkway") return make_unique<MtKWayMergeSort>(th);
+    if (name == "range") return make_unique<RangeSort>();
+    if (name == "mtrange") return make_unique<RangeSort>(th);
+    if (name == "auto") return make_unique<AutoSort>();
+    return nullptr;
+}
+
+SortService* gService = nullptr;
+
+/**
+ * @brief Serves sort requests on a Unix domain socket until SIGINT or SIGTERM.
+ * 
+ * @param path - socket path
+ * @param alg - algorithm name accepted by MakeAlg
+ * @param workers - number of worker threads
+ * @param th - number of threads of one multithread algorithm
+ */
+void RunService(const string& path, const string& alg, uint workers, uint th) {
+    if (!MakeAlg(alg, th)) {
+        cerr << "Unknown algorithm " << alg << endl;
+        return;
+    }
+    SortService service = SortService(path, [alg, th]() { return MakeAlg(alg, th); }, workers);
+    gService = &service;
+    signal(SIGINT, [](int) { gService->Stop(); });
+    signal(SIGTERM, [](int) { gService->Stop(); });
+    service.Serve();
+    gService = nullptr;
+}
+
 /**
  * @brief Main function of the tester.
+ * Usage: sorttester [scaling [pin]]
+ *        sorttester isolate [parallel runs] [numa node]
+ *        sorttester cardinality
+ *        sorttester strings
+ *        sorttester memory [policy...]
+ *        sorttester tune [max threads]
+ *        sorttester serve <socket> <alg> [workers] [threads]
+ *        sorttester load <socket> <rate> <seconds> [connections]
+ *        sorttester dataset <file>[:int64|:record:<size>:<key offset>:<key size>]
  * 
  */
-int main(/*int argc, char const *argv[]*/) {
+int main(int argc, char const *argv[]) {
     srand(time(NULL));
+    string mode = argc > 1 ? argv[1] : "";
+    if (mode == "scaling") {
+        RunScaling(argc > 2 && string(argv[2]) == "pin");
+        return 0;
+    }
+    if (mode == "cardinality") {
+        RunCardinality();
+        return 0;
+    }
+    if (mode == "memory") {
+        vector<string> policies(argv + 2, argv + argc);
+        if (policies.empty())
+            policies = {"system", "4k", "2m", "1g", "4k-interleave", "2m-interleave"};
+        RunMemory(policies);
+        return 0;
+    }
+    if (mode == "tune") {
+        Autotuner tuner = Autotuner(argc > 2 ? stoi(argv[2]) : 0);
+        tuner.Tune().Save(AutoSort::kProfilePath);
+        return 0;
+    }
+    if (mode == "strings") {
+        RunStrings();
+        return 0;
+    }
+    if (mode == "serve" && argc > 3) {
+        RunService(argv[2], argv[3], argc > 4 ? stoi(argv[4]) : 4,
+                   argc > 5 ? stoi(argv[5]) : 2);
+        return 0;
+    }
+    if (mode == "load" && argc > 4) {
+        // mostly small requests with an occasional large one
+        LoadGenerator load = LoadGenerator(argv[2], stod(argv[3]), stod(argv[4]),
+                                           {{100, 0.6}, {1000, 0.3}, {10000, 0.09}, {100000, 0.01}},
+                                           argc > 5 ? stoi(argv[5]) : 4);
+        load.Run();
+        return 0;
+    }
+
     TesterFramework tester = TesterFramework();
+    if (mode == "isolate" &&
+        !tester.SetIsolation(true, argc > 2 ? stoi(argv[2]) : 1, argc > 3 ? stoi(argv[3]) : -1))
+        return 1;
+    DatasetSpec spec;
+    if (mode == "dataset" && argc > 2 &&
+        !(DatasetSpec::Parse(argv[2], spec) && tester.SetDataset(DatasetCache::Get(spec))))
+        return 1;
+    // progress for monitoring, SORTTESTER_METRICS_PORT also serves it over HTTP
+    const char* port = getenv("SORTTESTER_METRICS_PORT");
+    tester.EnableMetrics("output-data/metrics.prom", port ? atoi(port) : 0);
     // tester.AddAlg(make_unique<InsertSort>());
 
     // tester.AddAlg(make_unique<MergeSort>());
@@ -39,9 +236,19 @@ int main(/*int argc, char const *argv[]*/) {
     // tester.AddAlg(make_unique<MtMergeSort>(3));
     // tester.AddAlg(make_unique<QuickSort>(1));
 
+    // tester.AddAlg(make_unique<MergeSort>());
+    // tester.AddAlg(make_unique<KWayMergeSort>());
+    // tester.AddAlg(make_unique<MtKWayMergeSort>(4));
+
+    // tester.AddAlg(make_unique<RangeSort>());
+    // tester.AddAlg(make_unique<RangeSort>(4));
+
+    // tester.AddAlg(make_unique<AutoSort>());
+
     tester.AddAlg(make_unique<MtMergeSort>(4));
     tester.AddAlg(make_unique<MtQuickSort>(4));
 
-    tester.StartTests();
-    return 0;
+    bool done = tester.StartTests();
+    TRACE_DUMP("output-data/trace.json");
+    return done ? 0 : 1;
 }